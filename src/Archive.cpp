@@ -0,0 +1,40 @@
+#include "Archive.hpp"
+
+#include "fmt/format.h"
+
+#include <fstream>
+#include <stdexcept>
+
+namespace Archive
+{
+	std::filesystem::path find(const std::filesystem::path& src, const char* filename)
+	{
+		std::filesystem::path path{ fmt::format("{}/{}", src.string(), filename) };
+
+		if (!std::filesystem::is_regular_file(path))
+		{
+			throw std::runtime_error{ fmt::format("Can't find \"{}\" in \"{}\"", filename, src.string()) };
+		}
+
+		return path;
+	}
+
+	std::vector<CdDataLocFileInfo> readLoc(const std::filesystem::path& cdDataLocPath)
+	{
+		std::ifstream cdDataLoc{ cdDataLocPath, std::ifstream::binary };
+
+		u32 nbFiles{};
+		cdDataLoc.read((char*)&nbFiles, sizeof(nbFiles));
+		const auto locFileInfoSize{ static_cast<u64>(nbFiles) * sizeof(CdDataLocFileInfo) };
+
+		if (std::filesystem::file_size(cdDataLocPath) != locFileInfoSize + locHeaderSize)
+		{
+			throw std::runtime_error{ fmt::format("\"{}\" is invalid", cdDataLocFilename) };
+		}
+
+		std::vector<CdDataLocFileInfo> filesInfo(nbFiles);
+		cdDataLoc.read((char*)filesInfo.data(), locFileInfoSize);
+
+		return filesInfo;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,31 @@
+#pragma once
+
+#include "Types.hpp"
+
+#include <filesystem>
+#include <vector>
+
+namespace Archive
+{
+	inline constexpr auto
+		sectorSize{ 2048u },
+		locHeaderSize{ 4u };
+
+	inline constexpr auto
+		cdData000Filename{ "CDDATA.000" },
+		cdDataLocFilename{ "CDDATA.LOC" },
+		dataDirectory{ "data" },
+		// Files of unknown versions, named by index
+		unknownDirectory{ "unknown" };
+
+	struct CdDataLocFileInfo
+	{
+		u32 position;
+		u32 size;
+		u32 nbSectors;
+		s32 isABin;
+	};
+
+	std::filesystem::path find(const std::filesystem::path& src, const char* filename);
+	std::vector<CdDataLocFileInfo> readLoc(const std::filesystem::path& cdDataLocPath);
+}
\ No newline at end of file
@@ -0,0 +1,245 @@
+#include "ArchiveWriter.hpp"
+
+#include "Diff.hpp"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+
+// Padding of every entry is served from this page instead of being cleared in the buffer
+alignas(File::directAlignment) static constexpr char zeroSector[Archive::sectorSize]{};
+
+// Keeps a flush within a single pwritev
+static constexpr std::size_t maxSegments{ 1024 };
+
+// Granularity of the rewrites of an updated archive
+static constexpr std::size_t compareBlockSize{ File::directAlignment };
+
+ArchiveWriter::ArchiveWriter(const std::filesystem::path& dest, u32 nbFiles, bool direct, bool update, std::size_t bufferSize)
+	: m_update{ update && std::filesystem::is_regular_file(fmt::format("{}/{}", dest.string(), Archive::cdData000Filename)) },
+	m_cdData000Path{ fmt::format("{}/{}", dest.string(), Archive::cdData000Filename) },
+	// Updates compare through the page cache, direct I/O would read every block from the disk
+	m_cdData000{ m_cdData000Path, m_update ? File::Mode::Update : File::Mode::Write, direct && !m_update },
+	m_cdDataLocPath{ fmt::format("{}/{}", dest.string(), Archive::cdDataLocFilename) },
+	m_filesInfo(nbFiles),
+	m_buffer{ alignUp(bufferSize, File::directAlignment) },
+	m_bufferUsed{},
+	m_flushPosition{},
+	m_sectorPosition{},
+	m_direct{ m_cdData000.isDirect() },
+	m_nbBytesWritten{},
+	m_merklePath{ fmt::format("{}/{}", dest.string(), Merkle::filename) }
+{
+	m_segments.reserve(maxSegments);
+
+	if (m_update && std::filesystem::is_regular_file(m_merklePath))
+	{
+		if (Merkle::Tree tree{ m_merklePath }; tree.isCurrent(m_cdData000Path))
+		{
+			m_merkle = std::move(tree);
+		}
+	}
+}
+
+char* ArchiveWriter::add(u32 index, u32 size, bool isABin)
+{
+	if (index >= m_filesInfo.size())
+	{
+		m_filesInfo.resize(index + 1);
+	}
+
+	const auto nbSectors{ (size + Archive::sectorSize - 1) / Archive::sectorSize };
+	const auto padding{ nbSectors * Archive::sectorSize - size };
+
+	m_filesInfo[index] =
+	{
+		.position = m_sectorPosition,
+		.size = size,
+		.nbSectors = nbSectors,
+		.isABin = static_cast<s32>(isABin)
+	};
+	m_sectorPosition += nbSectors;
+
+	// Direct I/O needs the sectors contiguous in the aligned buffer, padding included
+	reserve(m_direct ? size + padding : size);
+
+	auto* const data{ m_buffer.data() + m_bufferUsed };
+	m_bufferUsed += size;
+
+	if (m_direct)
+	{
+		std::memcpy(data + size, zeroSector, padding);
+		m_bufferUsed += padding;
+	}
+	else
+	{
+		if (size)
+		{
+			m_segments.push_back({ data, size });
+		}
+		if (padding)
+		{
+			m_segments.push_back({ zeroSector, padding });
+		}
+	}
+
+	return data;
+}
+
+std::vector<Archive::CdDataLocFileInfo>& ArchiveWriter::filesInfo()
+{
+	return m_filesInfo;
+}
+
+void ArchiveWriter::finish()
+{
+	flush();
+
+	if (m_bufferUsed)
+	{
+		// Direct I/O tail, the last block is padded to the alignment then the archive is cut back to its real size
+		const auto alignedSize{ static_cast<std::size_t>(alignUp(m_bufferUsed, File::directAlignment)) };
+		std::memset(m_buffer.data() + m_bufferUsed, 0, alignedSize - m_bufferUsed);
+		m_cdData000.write(m_flushPosition, m_buffer.data(), alignedSize);
+		m_cdData000.resize(m_flushPosition + m_bufferUsed);
+		m_nbBytesWritten += m_bufferUsed;
+		m_bufferUsed = 0;
+	}
+	else if (m_update && m_cdData000.size() != m_flushPosition)
+	{
+		m_cdData000.resize(m_flushPosition);
+	}
+
+	// A stale tree or a rewritten archive is hashed again whole
+	if (m_merkle)
+	{
+		m_merkle->update(m_cdData000Path);
+		m_merkle->save(m_merklePath);
+	}
+	else if (std::filesystem::is_regular_file(m_merklePath))
+	{
+		Merkle::Tree::build(m_cdData000Path).save(m_merklePath);
+	}
+
+	const auto nbFiles{ static_cast<u32>(m_filesInfo.size()) };
+	std::vector<char> cdDataLoc(sizeof(nbFiles) + m_filesInfo.size() * sizeof(Archive::CdDataLocFileInfo));
+	std::memcpy(cdDataLoc.data(), &nbFiles, sizeof(nbFiles));
+	std::memcpy(cdDataLoc.data() + sizeof(nbFiles), m_filesInfo.data(), m_filesInfo.size() * sizeof(Archive::CdDataLocFileInfo));
+
+	if (m_update && std::filesystem::is_regular_file(m_cdDataLocPath) && std::filesystem::file_size(m_cdDataLocPath) == cdDataLoc.size())
+	{
+		const MappedFile existing{ m_cdDataLocPath };
+
+		if (Diff::equal({ existing.data(), existing.size() }, cdDataLoc))
+		{
+			return;
+		}
+	}
+
+	std::ofstream{ m_cdDataLocPath, std::ofstream::binary }.write(cdDataLoc.data(), cdDataLoc.size());
+}
+
+u64 ArchiveWriter::nbBytesWritten() const
+{
+	return m_nbBytesWritten;
+}
+
+void ArchiveWriter::reserve(std::size_t size)
+{
+	if (m_bufferUsed + size > m_buffer.size() || m_segments.size() + 2 > maxSegments)
+	{
+		flush();
+	}
+
+	if (m_bufferUsed + size > m_buffer.size())
+	{
+		// Entries bigger than the buffer grow it once, memory stays bounded by the largest entry
+		AlignedBuffer buffer{ alignUp(m_bufferUsed + size, File::directAlignment) };
+		std::memcpy(buffer.data(), m_buffer.data(), m_bufferUsed);
+		m_buffer = std::move(buffer);
+	}
+}
+
+void ArchiveWriter::flush()
+{
+	// Stays on the contiguous layout even if the filesystem made the file fall back to buffered I/O
+	if (m_direct)
+	{
+		// Only whole aligned blocks are written, the unaligned tail is kept for the next flush
+		const auto alignedSize{ static_cast<std::size_t>(alignDown(m_bufferUsed, File::directAlignment)) };
+
+		if (alignedSize)
+		{
+			m_cdData000.write(m_flushPosition, m_buffer.data(), alignedSize);
+			m_nbBytesWritten += alignedSize;
+			std::memmove(m_buffer.data(), m_buffer.data() + alignedSize, m_bufferUsed - alignedSize);
+			m_flushPosition += alignedSize;
+			m_bufferUsed -= alignedSize;
+		}
+	}
+	else if (!m_segments.empty())
+	{
+		if (m_update)
+		{
+			writeChanged();
+		}
+		else
+		{
+			m_cdData000.write(m_flushPosition, m_segments);
+
+			for (const auto& segment : m_segments)
+			{
+				m_nbBytesWritten += segment.size;
+			}
+		}
+
+		for (const auto& segment : m_segments)
+		{
+			m_flushPosition += segment.size;
+		}
+
+		m_segments.clear();
+		m_bufferUsed = 0;
+	}
+}
+
+void ArchiveWriter::writeChanged()
+{
+	std::size_t size{};
+
+	for (const auto& segment : m_segments)
+	{
+		size += segment.size;
+	}
+
+	// Whatever lies past the end of the existing archive differs
+	m_existing.resize(size);
+	const auto nbRead{ m_cdData000.read(m_flushPosition, m_existing.data(), size) };
+	std::size_t offset{};
+
+	for (const auto& segment : m_segments)
+	{
+		const auto* const data{ static_cast<const char*>(segment.data) };
+
+		for (std::size_t blockOffset{}; blockOffset < segment.size; blockOffset += compareBlockSize)
+		{
+			const auto blockSize{ std::min(compareBlockSize, segment.size - blockOffset) };
+			const auto existingOffset{ offset + blockOffset };
+
+			if (existingOffset + blockSize > nbRead || !Diff::equal({ data + blockOffset, blockSize }, { m_existing.data() + existingOffset, blockSize }))
+			{
+				m_cdData000.write(m_flushPosition + existingOffset, data + blockOffset, blockSize);
+				m_nbBytesWritten += blockSize;
+
+				if (m_merkle)
+				{
+					m_merkle->touch(m_flushPosition + existingOffset, blockSize);
+				}
+			}
+		}
+
+		offset += segment.size;
+	}
+}
\ No newline at end of file
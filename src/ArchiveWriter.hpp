@@ -0,0 +1,51 @@
+#pragma once
+
+#include "Archive.hpp"
+#include "File.hpp"
+#include "Merkle.hpp"
+#include "Types.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <vector>
+
+// Appends entries to CDDATA.000 by gathering them with their sector padding into large vectored
+// writes, CDDATA.LOC is written by finish(). When updating, an existing archive is compared block by block and only
+// what differs is written, files left identical keep their modification time. A Merkle tree next to the archive
+// is kept up to date
+class ArchiveWriter
+{
+public:
+	static constexpr auto defaultBufferSize{ 8u * 1024 * 1024 };
+
+	ArchiveWriter(const std::filesystem::path& dest, u32 nbFiles, bool direct, bool update = false, std::size_t bufferSize = defaultBufferSize);
+
+	// Returns where the size bytes of the entry must be written before the next call
+	char* add(u32 index, u32 size, bool isABin);
+	// Can be rearranged before finish() when indices are only known once every entry is added
+	std::vector<Archive::CdDataLocFileInfo>& filesInfo();
+	void finish();
+	// Bytes of CDDATA.000 actually written, the changed blocks only when updating
+	u64 nbBytesWritten() const;
+private:
+	void reserve(std::size_t size);
+	void flush();
+	void writeChanged();
+
+	bool m_update;
+	std::filesystem::path m_cdData000Path;
+	File m_cdData000;
+	std::filesystem::path m_cdDataLocPath;
+	std::vector<Archive::CdDataLocFileInfo> m_filesInfo;
+	AlignedBuffer m_buffer;
+	std::size_t m_bufferUsed;
+	std::vector<File::Segment> m_segments;
+	u64 m_flushPosition;
+	u32 m_sectorPosition;
+	bool m_direct;
+	std::vector<char> m_existing;
+	u64 m_nbBytesWritten;
+	std::filesystem::path m_merklePath;
+	// Tree of the existing archive, re-hashed from the changed blocks only when updating
+	std::optional<Merkle::Tree> m_merkle;
+};
\ No newline at end of file
@@ -0,0 +1,49 @@
+#include "Batch.hpp"
+
+#include "Types.hpp"
+
+#include "fmt/format.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace Batch
+{
+	std::vector<Job> readManifest(const std::filesystem::path& manifestPath)
+	{
+		std::ifstream manifest{ manifestPath };
+
+		if (!manifest)
+		{
+			throw std::runtime_error{ fmt::format("Can't open \"{}\"", manifestPath.string()) };
+		}
+
+		std::vector<Job> jobs;
+		std::string line;
+
+		for (u32 lineNumber{ 1 }; std::getline(manifest, line); ++lineNumber)
+		{
+			std::istringstream stream{ line };
+			std::string operation, src, dest;
+
+			if (!(stream >> operation) || operation.starts_with('#'))
+			{
+				continue;
+			}
+
+			stream >> std::quoted(src) >> std::quoted(dest);
+
+			if (!stream || (operation != "unpack" && operation != "repack"))
+			{
+				throw std::runtime_error{ fmt::format("Line {} of \"{}\" is invalid", lineNumber, manifestPath.string()) };
+			}
+
+			jobs.push_back({ operation == "unpack" ? Operation::Unpack : Operation::Repack, src, dest });
+		}
+
+		return jobs;
+	}
+}
\ No newline at end of file
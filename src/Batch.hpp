@@ -0,0 +1,24 @@
+#pragma once
+
+#include <filesystem>
+#include <vector>
+
+// Unpacks and repacks of several archives listed in a manifest
+namespace Batch
+{
+	enum class Operation
+	{
+		Unpack,
+		Repack
+	};
+
+	struct Job
+	{
+		Operation operation;
+		std::filesystem::path src;
+		std::filesystem::path dest;
+	};
+
+	// One job per line as "unpack src dest" or "repack src dest", paths with spaces are quoted, # for comments
+	std::vector<Job> readManifest(const std::filesystem::path& manifestPath);
+}
\ No newline at end of file
@@ -0,0 +1,325 @@
+#include "CApi.h"
+
+#include "Archive.hpp"
+#include "ArchiveWriter.hpp"
+#include "CDData000.hpp"
+#include "File.hpp"
+#include "Magic.hpp"
+#include "Types.hpp"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <filesystem>
+#include <limits>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct jcur2_archive
+{
+	std::vector<Archive::CdDataLocFileInfo> filesInfo;
+	MappedFile cdData000;
+	// Paths separated by null characters, pathOffsets has one more offset for the end
+	std::string paths;
+	std::vector<u32> pathOffsets;
+	// Indices sorted by path for jcur2_find
+	std::vector<u32> sortedIndices;
+	mutable std::atomic<u64> nbReads;
+	mutable std::atomic<u64> nbBytesRead;
+
+	std::string_view path(u32 index) const
+	{
+		return { paths.data() + pathOffsets[index], pathOffsets[index + 1] - pathOffsets[index] - 1 };
+	}
+};
+
+static thread_local std::string lastError;
+
+// Exceptions stop here, turned into a status and the message of jcur2_last_error
+template <typename Function>
+static jcur2_status guard(jcur2_status status, Function&& function)
+{
+	try
+	{
+		lastError.clear();
+		return function();
+	}
+	catch (const std::filesystem::filesystem_error& e)
+	{
+		lastError = e.what();
+		return JCUR2_ERROR_IO;
+	}
+	catch (const std::exception& e)
+	{
+		lastError = e.what();
+		return status;
+	}
+	catch (...)
+	{
+		lastError = "Unknown error";
+		return JCUR2_ERROR_INTERNAL;
+	}
+}
+
+static jcur2_status fail(jcur2_status status, std::string message)
+{
+	lastError = std::move(message);
+	return status;
+}
+
+// Every call clears the error of the previous one, as guard does
+static jcur2_status succeed()
+{
+	lastError.clear();
+	return JCUR2_OK;
+}
+
+extern "C"
+{
+	uint32_t jcur2_abi_version(void)
+	{
+		return JCUR2_ABI_VERSION;
+	}
+
+	const char* jcur2_last_error(void)
+	{
+		return lastError.c_str();
+	}
+
+	jcur2_status jcur2_open(const char* src, jcur2_archive** archive)
+	{
+		if (!src || !archive)
+		{
+			return fail(JCUR2_ERROR_ARGUMENT, "src and archive can't be null");
+		}
+
+		return guard(JCUR2_ERROR_INVALID_ARCHIVE, [&]()
+		{
+			auto filesInfo{ Archive::readLoc(Archive::find(src, Archive::cdDataLocFilename)) };
+			MappedFile cdData000{ Archive::find(src, Archive::cdData000Filename) };
+			const auto* const version{ CDData000::findVersion(filesInfo) };
+			const auto nbFiles{ static_cast<u32>(filesInfo.size()) };
+
+			// Owned until it's handed over so a throw while naming the files doesn't leak it
+			auto result{ std::make_unique<jcur2_archive>(std::move(filesInfo), std::move(cdData000)) };
+			result->pathOffsets.reserve(nbFiles + 1);
+			CDData000::PathBuffer pathBuffer;
+
+			// Paths as the unpacker names files, generic names need the type of the content
+			for (u32 i{}; i < nbFiles; ++i)
+			{
+				const auto& fileInfo{ result->filesInfo[i] };
+				const auto position{ static_cast<u64>(fileInfo.position) * Archive::sectorSize };
+
+				result->pathOffsets.push_back(static_cast<u32>(result->paths.size()));
+
+				if (version)
+				{
+					result->paths += version->filesPath.path(i, pathBuffer);
+				}
+				else
+				{
+					const auto size{ position + fileInfo.size <= result->cdData000.size() ? std::min<std::size_t>(fileInfo.size, Magic::headerSize) : 0 };
+					result->paths += fmt::format("{}/{:05}{}", Archive::unknownDirectory, i,
+						Magic::type(result->cdData000.data() + (size ? position : 0), size, fileInfo.isABin));
+				}
+
+				result->paths += '\0';
+			}
+			result->pathOffsets.push_back(static_cast<u32>(result->paths.size()));
+
+			result->sortedIndices.resize(nbFiles);
+			for (u32 i{}; i < nbFiles; ++i)
+			{
+				result->sortedIndices[i] = i;
+			}
+			std::sort(result->sortedIndices.begin(), result->sortedIndices.end(), [&](u32 lhs, u32 rhs) { return result->path(lhs) < result->path(rhs); });
+
+			*archive = result.release();
+			return JCUR2_OK;
+		});
+	}
+
+	void jcur2_close(jcur2_archive* archive)
+	{
+		delete archive;
+	}
+
+	uint32_t jcur2_entry_count(const jcur2_archive* archive)
+	{
+		return archive ? static_cast<uint32_t>(archive->filesInfo.size()) : 0;
+	}
+
+	jcur2_status jcur2_get_entry(const jcur2_archive* archive, uint32_t index, jcur2_entry* entry)
+	{
+		if (!archive || !entry)
+		{
+			return fail(JCUR2_ERROR_ARGUMENT, "archive and entry can't be null");
+		}
+		else if (index >= archive->filesInfo.size())
+		{
+			return fail(JCUR2_ERROR_NOT_FOUND, "Index is out of range");
+		}
+
+		const auto& fileInfo{ archive->filesInfo[index] };
+		const auto path{ archive->path(index) };
+		*entry = { index, fileInfo.position, fileInfo.size, fileInfo.nbSectors, fileInfo.isABin, path.data(), path.size() };
+		return succeed();
+	}
+
+	jcur2_status jcur2_find(const jcur2_archive* archive, const char* path, uint32_t* index)
+	{
+		if (!archive || !path || !index)
+		{
+			return fail(JCUR2_ERROR_ARGUMENT, "archive, path and index can't be null");
+		}
+
+		const std::string_view pathView{ path };
+		const auto& indices{ archive->sortedIndices };
+		const auto it{ std::lower_bound(indices.begin(), indices.end(), pathView, [&](u32 i, std::string_view path) { return archive->path(i) < path; }) };
+
+		if (it == indices.end() || archive->path(*it) != pathView)
+		{
+			return fail(JCUR2_ERROR_NOT_FOUND, "Path is not in the archive");
+		}
+
+		*index = *it;
+		return succeed();
+	}
+
+	// Data of an entry in the mapping, nullptr when CDDATA.000 is truncated
+	static const char* entryData(const jcur2_archive* archive, uint32_t index)
+	{
+		const auto& fileInfo{ archive->filesInfo[index] };
+		const auto position{ static_cast<u64>(fileInfo.position) * Archive::sectorSize };
+		return position + fileInfo.size <= archive->cdData000.size() ? archive->cdData000.data() + position : nullptr;
+	}
+
+	jcur2_status jcur2_read(const jcur2_archive* archive, uint32_t index, uint64_t offset, void* buffer, size_t size, size_t* nb_read)
+	{
+		if (!archive || (!buffer && size) || !nb_read)
+		{
+			return fail(JCUR2_ERROR_ARGUMENT, "archive, buffer and nb_read can't be null");
+		}
+		else if (index >= archive->filesInfo.size())
+		{
+			return fail(JCUR2_ERROR_NOT_FOUND, "Index is out of range");
+		}
+
+		const auto entrySize{ archive->filesInfo[index].size };
+		const auto* const data{ entryData(archive, index) };
+
+		if (!data)
+		{
+			return fail(JCUR2_ERROR_INVALID_ARCHIVE, "CDDATA.000 is truncated");
+		}
+		else if (offset > entrySize)
+		{
+			return fail(JCUR2_ERROR_RANGE, "Offset is past the end of the entry");
+		}
+
+		*nb_read = static_cast<size_t>(std::min<u64>(size, entrySize - offset));
+		std::copy_n(data + offset, *nb_read, static_cast<char*>(buffer));
+
+		++archive->nbReads;
+		archive->nbBytesRead += *nb_read;
+		return succeed();
+	}
+
+	jcur2_status jcur2_read_chunks(const jcur2_archive* archive, uint32_t index, size_t chunk_size, jcur2_read_callback callback, void* user)
+	{
+		if (!archive || !callback || !chunk_size)
+		{
+			return fail(JCUR2_ERROR_ARGUMENT, "archive and callback can't be null, chunk_size can't be 0");
+		}
+		else if (index >= archive->filesInfo.size())
+		{
+			return fail(JCUR2_ERROR_NOT_FOUND, "Index is out of range");
+		}
+
+		const auto entrySize{ archive->filesInfo[index].size };
+		const auto* const data{ entryData(archive, index) };
+
+		if (!data)
+		{
+			return fail(JCUR2_ERROR_INVALID_ARCHIVE, "CDDATA.000 is truncated");
+		}
+
+		++archive->nbReads;
+
+		for (u64 offset{}; offset < entrySize; offset += chunk_size)
+		{
+			const auto size{ static_cast<size_t>(std::min<u64>(chunk_size, entrySize - offset)) };
+			archive->nbBytesRead += size;
+
+			if (callback(user, offset, data + offset, size) != 0)
+			{
+				return fail(JCUR2_ERROR_CALLBACK, "Read callback stopped");
+			}
+		}
+
+		return succeed();
+	}
+
+	jcur2_status jcur2_repack(const char* dest, uint32_t nb_files, const jcur2_repack_source* source)
+	{
+		if (!dest || !source || !source->entry || !source->read)
+		{
+			return fail(JCUR2_ERROR_ARGUMENT, "dest, source and its callbacks can't be null");
+		}
+
+		return guard(JCUR2_ERROR_IO, [&]()
+		{
+			std::filesystem::create_directories(dest);
+			ArchiveWriter archiveWriter{ dest, nb_files, false };
+			u64 totalSize{};
+
+			for (u32 i{}; i < nb_files; ++i)
+			{
+				u32 size{};
+				s32 isABin{};
+
+				if (source->entry(source->user, i, &size, &isABin) != 0)
+				{
+					return fail(JCUR2_ERROR_CALLBACK, fmt::format("Entry callback of file {} stopped", i));
+				}
+
+				totalSize += (static_cast<u64>(size) + Archive::sectorSize - 1) / Archive::sectorSize * Archive::sectorSize;
+
+				if (totalSize > std::numeric_limits<u32>::max())
+				{
+					return fail(JCUR2_ERROR_RANGE, "Files exceed the size limit of CDDATA.000");
+				}
+
+				if (source->read(source->user, i, archiveWriter.add(i, size, isABin != 0), size) != 0)
+				{
+					return fail(JCUR2_ERROR_CALLBACK, fmt::format("Read callback of file {} stopped", i));
+				}
+			}
+
+			archiveWriter.finish();
+			return JCUR2_OK;
+		});
+	}
+
+	jcur2_status jcur2_get_stats(const jcur2_archive* archive, jcur2_stats* stats)
+	{
+		if (!archive || !stats)
+		{
+			return fail(JCUR2_ERROR_ARGUMENT, "archive and stats can't be null");
+		}
+
+		u64 entriesSize{};
+		for (const auto& fileInfo : archive->filesInfo)
+		{
+			entriesSize += fileInfo.size;
+		}
+
+		*stats = { static_cast<uint32_t>(archive->filesInfo.size()), archive->cdData000.size(), entriesSize, archive->nbReads, archive->nbBytesRead };
+		return succeed();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,99 @@
+#ifndef JCUR2_CAPI_H
+#define JCUR2_CAPI_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Stable C interface of the jcur2 shared library: no exception crosses it, handles are opaque and structs
+   only grow at the end with a new JCUR2_ABI_VERSION */
+
+#if defined(_WIN32) && defined(JCUR2_BUILD)
+#define JCUR2_API __declspec(dllexport)
+#elif defined(_WIN32)
+#define JCUR2_API __declspec(dllimport)
+#else
+#define JCUR2_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define JCUR2_ABI_VERSION 1
+
+typedef enum jcur2_status
+{
+	JCUR2_OK = 0,
+	JCUR2_ERROR_ARGUMENT = 1,
+	JCUR2_ERROR_IO = 2,
+	JCUR2_ERROR_INVALID_ARCHIVE = 3,
+	JCUR2_ERROR_NOT_FOUND = 4,
+	JCUR2_ERROR_RANGE = 5,
+	/* A callback returned non-zero */
+	JCUR2_ERROR_CALLBACK = 6,
+	JCUR2_ERROR_INTERNAL = 7
+} jcur2_status;
+
+typedef struct jcur2_archive jcur2_archive;
+
+typedef struct jcur2_entry
+{
+	uint32_t index;
+	/* Sector of CDDATA.000 */
+	uint32_t position;
+	uint32_t size;
+	uint32_t nb_sectors;
+	int32_t is_a_bin;
+	/* Null terminated, valid until the archive is closed, "unknown/00042.tm2" for unknown versions */
+	const char* path;
+	size_t path_size;
+} jcur2_entry;
+
+typedef struct jcur2_stats
+{
+	uint32_t nb_entries;
+	uint64_t archive_size;
+	/* Sum of the entry sizes */
+	uint64_t entries_size;
+	/* Counted since the archive was opened, from every thread */
+	uint64_t nb_reads;
+	uint64_t nb_bytes_read;
+} jcur2_stats;
+
+/* Chunks of an entry straight from the mapping of CDDATA.000, returns non-zero to stop */
+typedef int (*jcur2_read_callback)(void* user, uint64_t offset, const void* data, size_t size);
+
+/* Source of a repack: entry gives the size and container flag of a file, read fills its size bytes */
+typedef struct jcur2_repack_source
+{
+	void* user;
+	int (*entry)(void* user, uint32_t index, uint32_t* size, int32_t* is_a_bin);
+	int (*read)(void* user, uint32_t index, void* buffer, uint32_t size);
+} jcur2_repack_source;
+
+JCUR2_API uint32_t jcur2_abi_version(void);
+/* Message of the last error of the calling thread, empty when its last call returning a status succeeded */
+JCUR2_API const char* jcur2_last_error(void);
+
+/* src is the directory of CDDATA.000 and CDDATA.LOC, the archive can be used from several threads */
+JCUR2_API jcur2_status jcur2_open(const char* src, jcur2_archive** archive);
+JCUR2_API void jcur2_close(jcur2_archive* archive);
+
+JCUR2_API uint32_t jcur2_entry_count(const jcur2_archive* archive);
+JCUR2_API jcur2_status jcur2_get_entry(const jcur2_archive* archive, uint32_t index, jcur2_entry* entry);
+JCUR2_API jcur2_status jcur2_find(const jcur2_archive* archive, const char* path, uint32_t* index);
+
+/* Reads never allocate, nb_read is less than size at the end of the entry */
+JCUR2_API jcur2_status jcur2_read(const jcur2_archive* archive, uint32_t index, uint64_t offset, void* buffer, size_t size, size_t* nb_read);
+JCUR2_API jcur2_status jcur2_read_chunks(const jcur2_archive* archive, uint32_t index, size_t chunk_size, jcur2_read_callback callback, void* user);
+
+/* CDDATA.000 and CDDATA.LOC of nb_files files written to the dest directory in index order */
+JCUR2_API jcur2_status jcur2_repack(const char* dest, uint32_t nb_files, const jcur2_repack_source* source);
+
+JCUR2_API jcur2_status jcur2_get_stats(const jcur2_archive* archive, jcur2_stats* stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
\ No newline at end of file
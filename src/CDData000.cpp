@@ -1,11 +1,17 @@
 #include "CDData000.hpp"
 
+#include "Hash.hpp"
+
+#include <algorithm>
 #include <array>
 #include <stdexcept>
+#include <string_view>
+#include <vector>
 
 namespace CDData000
 {
-	static constexpr std::array<const char*, 5249> filesPathId
+	// Only read at compile time to build pathTable
+	static constexpr std::array<const char*, nbIds> filesPathId
 	{
 		"data/public/ascii_tes_16.tm2",
 		"data/eventscript/b001.ccb",
@@ -5258,22 +5264,402 @@ namespace CDData000
 		"data/sprite/bg/bgtex.tm2"
 	};
 
-	std::vector<const char*> filesPath(u32 nbFiles)
+	// Compile time evaluation is bounded by compilers, the table is built in several steps with plain loops
+	struct PathSize
+	{
+		u8 size;
+		u8 directorySize;
+	};
+
+	static consteval std::array<PathSize, nbIds> makePathsSize()
+	{
+		std::array<PathSize, nbIds> pathsSize{};
+
+		for (u32 id{}; id < nbIds; ++id)
+		{
+			const auto* const path{ filesPathId[id] };
+			auto* const pathSize{ &pathsSize[id] };
+
+			for (; path[pathSize->size]; ++pathSize->size)
+			{
+				if (path[pathSize->size] == '/')
+				{
+					pathSize->directorySize = pathSize->size + 1;
+				}
+			}
+		}
+
+		return pathsSize;
+	}
+
+	static constexpr auto pathsSize{ makePathsSize() };
+
+	static constexpr int compare(const char* a, std::size_t aSize, const char* b, std::size_t bSize)
+	{
+		const auto size{ aSize < bSize ? aSize : bSize };
+
+		for (std::size_t i{}; i < size; ++i)
+		{
+			if (a[i] != b[i])
+			{
+				return static_cast<u8>(a[i]) < static_cast<u8>(b[i]) ? -1 : 1;
+			}
+		}
+
+		return aSize == bSize ? 0 : aSize < bSize ? -1 : 1;
+	}
+
+	struct DirectoriesIndex
+	{
+		std::array<u8, nbIds> directory;
+		std::array<u16, 256> firstId;
+		std::size_t nbDirectories;
+		std::size_t directoriesSize;
+		std::size_t namesSize;
+	};
+
+	static consteval DirectoriesIndex makeDirectoriesIndex()
+	{
+		DirectoriesIndex index{};
+
+		const auto isInDirectory{ [](u32 id, u32 directoryId)
+		{
+			return compare(filesPathId[id], pathsSize[id].directorySize, filesPathId[directoryId], pathsSize[directoryId].directorySize) == 0;
+		}};
+
+		for (u32 id{}; id < nbIds; ++id)
+		{
+			// Paths of a directory mostly follow each other
+			if (id && isInDirectory(id, id - 1))
+			{
+				index.directory[id] = index.directory[id - 1];
+			}
+			else
+			{
+				std::size_t directory{};
+				while (directory < index.nbDirectories && !isInDirectory(id, index.firstId[directory]))
+				{
+					++directory;
+				}
+
+				if (directory == index.nbDirectories)
+				{
+					index.firstId[index.nbDirectories++] = static_cast<u16>(id);
+					index.directoriesSize += pathsSize[id].directorySize;
+				}
+
+				index.directory[id] = static_cast<u8>(directory);
+			}
+
+			index.namesSize += pathsSize[id].size - pathsSize[id].directorySize;
+		}
+
+		return index;
+	}
+
+	static constexpr auto directoriesIndex{ makeDirectoriesIndex() };
+
+	// Ids grouped by directory and sorted by file name so a path is found by a binary search
+	static consteval std::array<u16, nbIds> makeDirectoryIds()
 	{
-		static constexpr auto nbFilesNtscJ{ 5247u };
-		std::vector<const char*> vFilesPath{ CDData000::filesPathId.begin(), CDData000::filesPathId.end() };
+		std::array<u16, nbIds> directoryIds{};
+		std::array<std::size_t, 257> directoryEnd{};
 
-		if (nbFiles == nbFilesNtscJ)
+		for (u32 id{}; id < nbIds; ++id)
+		{
+			++directoryEnd[directoriesIndex.directory[id] + 1u];
+		}
+		for (std::size_t i{}; i < directoriesIndex.nbDirectories; ++i)
 		{
-			// Ntsc-J version doesn't contain eventscript/m2esa0330.bin and esdata/a0330.evs
-			vFilesPath.erase(vFilesPath.begin() + 975);
-			vFilesPath.erase(vFilesPath.begin() + 4630);
+			directoryEnd[i + 1] += directoryEnd[i];
 		}
-		else if (nbFiles != CDData000::filesPathId.size())
+		for (u32 id{}; id < nbIds; ++id)
 		{
-			throw std::runtime_error{ "Invalid number of files" };
+			directoryIds[directoryEnd[directoriesIndex.directory[id]]++] = static_cast<u16>(id);
 		}
 
-		return vFilesPath;
+		const auto nameLess{ [](u16 a, u16 b)
+		{
+			return compare(filesPathId[a] + pathsSize[a].directorySize, pathsSize[a].size - pathsSize[a].directorySize,
+				filesPathId[b] + pathsSize[b].directorySize, pathsSize[b].size - pathsSize[b].directorySize) < 0;
+		}};
+
+		for (std::size_t i{}, begin{}; i < directoriesIndex.nbDirectories; begin = directoryEnd[i++])
+		{
+			std::sort(directoryIds.begin() + begin, directoryIds.begin() + directoryEnd[i], nameLess);
+		}
+
+		return directoryIds;
+	}
+
+	// Paths stored as a directory id and a file name, rebuilt on demand into caller buffers
+	template <std::size_t NbDirectories, std::size_t DirectoriesSize, std::size_t NamesSize>
+	class PathTable
+	{
+	public:
+		consteval PathTable()
+			: m_directories{}, m_directoriesOffset{}, m_names{}, m_namesOffset{},
+			m_directory{ directoriesIndex.directory }, m_directoryIds{ makeDirectoryIds() }, m_directoryIdsOffset{}
+		{
+			for (std::size_t i{}; i < NbDirectories; ++i)
+			{
+				const auto id{ directoriesIndex.firstId[i] };
+				const auto directorySize{ pathsSize[id].directorySize };
+
+				for (std::size_t j{}; j < directorySize; ++j)
+				{
+					m_directories[m_directoriesOffset[i] + j] = filesPathId[id][j];
+				}
+				m_directoriesOffset[i + 1] = static_cast<u16>(m_directoriesOffset[i] + directorySize);
+			}
+
+			for (u32 id{}; id < nbIds; ++id)
+			{
+				const auto [size, directorySize] { pathsSize[id] };
+
+				for (std::size_t j{ directorySize }; j < size; ++j)
+				{
+					m_names[m_namesOffset[id] + j - directorySize] = filesPathId[id][j];
+				}
+				m_namesOffset[id + 1] = static_cast<u32>(m_namesOffset[id] + size - directorySize);
+				++m_directoryIdsOffset[m_directory[id] + 1u];
+			}
+
+			for (std::size_t i{}; i < NbDirectories; ++i)
+			{
+				m_directoryIdsOffset[i + 1] += m_directoryIdsOffset[i];
+			}
+		}
+
+		constexpr std::string_view path(u32 id, PathBuffer& buffer) const
+		{
+			const auto directory{ directoryPath(m_directory[id]) }, name{ this->name(id) };
+			std::copy(directory.begin(), directory.end(), buffer.begin());
+			std::copy(name.begin(), name.end(), buffer.begin() + directory.size());
+			return { buffer.data(), directory.size() + name.size() };
+		}
+
+		constexpr std::string_view name(u32 id) const
+		{
+			return { m_names.data() + m_namesOffset[id], m_namesOffset[id + 1] - m_namesOffset[id] };
+		}
+
+		constexpr u32 directory(u32 id) const
+		{
+			return m_directory[id];
+		}
+
+		constexpr std::string_view directoryPath(u32 directory) const
+		{
+			return { m_directories.data() + m_directoriesOffset[directory],
+				static_cast<std::size_t>(m_directoriesOffset[directory + 1] - m_directoriesOffset[directory]) };
+		}
+
+		constexpr std::span<const u16> directoryIds(u32 directory) const
+		{
+			return { m_directoryIds.data() + m_directoryIdsOffset[directory], m_directoryIds.data() + m_directoryIdsOffset[directory + 1] };
+		}
+
+		constexpr std::optional<u32> find(std::string_view path) const
+		{
+			const auto directory{ path.substr(0, path.rfind('/') + 1) };
+
+			for (u32 i{}; i < NbDirectories; ++i)
+			{
+				if (directoryPath(i) == directory)
+				{
+					const auto ids{ directoryIds(i) };
+					const auto name{ path.substr(directory.size()) };
+					const auto it{ std::lower_bound(ids.begin(), ids.end(), name,
+						[this](u16 id, std::string_view name)
+						{
+							return this->name(id) < name;
+						}) };
+
+					if (it != ids.end() && this->name(*it) == name)
+					{
+						return *it;
+					}
+					break;
+				}
+			}
+
+			return std::nullopt;
+		}
+	private:
+		std::array<char, DirectoriesSize> m_directories;
+		std::array<u16, NbDirectories + 1> m_directoriesOffset;
+		std::array<char, NamesSize> m_names;
+		std::array<u32, nbIds + 1> m_namesOffset;
+		std::array<u8, nbIds> m_directory;
+		std::array<u16, nbIds> m_directoryIds;
+		std::array<u16, NbDirectories + 1> m_directoryIdsOffset;
+	};
+
+	static constexpr PathTable<directoriesIndex.nbDirectories, directoriesIndex.directoriesSize, directoriesIndex.namesSize> pathTable;
+
+	static consteval bool isPathTableValid()
+	{
+		for (u32 id{}; id < nbIds; ++id)
+		{
+			const auto [size, directorySize] { pathsSize[id] };
+			const auto directory{ pathTable.directoryPath(pathTable.directory(id)) };
+			const auto name{ pathTable.name(id) };
+
+			if (size > maxPathSize || compare(directory.data(), directory.size(), filesPathId[id], directorySize) != 0 ||
+				compare(name.data(), name.size(), filesPathId[id] + directorySize, size - directorySize) != 0)
+			{
+				return false;
+			}
+		}
+
+		return true;
+	}
+
+	static_assert(isPathTableValid());
+
+	template <std::size_t NbMissing>
+	static consteval u64 layoutSignature(const std::array<u16, NbMissing>& missing)
+	{
+		const PathView filesPath{ missing, nbIds - NbMissing };
+		Hash::Fnv1a hash;
+		hash.update(static_cast<u32>(filesPath.size()));
+
+		for (u32 i{}; i < filesPath.size(); ++i)
+		{
+			hash.update(static_cast<u8>(pathTable.name(filesPath.id(i)).ends_with(".bin")));
+		}
+
+		return hash.value();
+	}
+
+	static u64 layoutSignature(std::span<const Archive::CdDataLocFileInfo> filesInfo)
+	{
+		Hash::Fnv1a hash;
+		hash.update(static_cast<u32>(filesInfo.size()));
+
+		for (const auto& fileInfo : filesInfo)
+		{
+			hash.update(static_cast<u8>(fileInfo.isABin != 0));
+		}
+
+		return hash.value();
+	}
+
+	// Ntsc-J version doesn't contain eventscript/m2esa0330.bin and esdata/a0330.evs
+	static constexpr std::array<u16, 2> missingNtscJ{ 975, 4631 };
+	static constexpr std::array<u16, 0> missingNone{};
+
+	static constexpr std::array<Version, 2> versions
+	{{
+		{ "NTSC-J", PathView{ missingNtscJ, nbIds - missingNtscJ.size() }, layoutSignature(missingNtscJ) },
+		{ "NTSC-U / PAL", PathView{ missingNone, nbIds }, layoutSignature(missingNone) }
+	}};
+
+	std::string_view path(u32 id, PathBuffer& buffer)
+	{
+		return pathTable.path(id, buffer);
+	}
+
+	std::optional<u32> find(std::string_view path)
+	{
+		return pathTable.find(path);
+	}
+
+	u32 directory(u32 id)
+	{
+		return pathTable.directory(id);
+	}
+
+	u32 nbDirectories()
+	{
+		return static_cast<u32>(directoriesIndex.nbDirectories);
+	}
+
+	std::string_view directoryPath(u32 directory)
+	{
+		return pathTable.directoryPath(directory);
+	}
+
+	std::span<const u16> directoryIds(u32 directory)
+	{
+		return pathTable.directoryIds(directory);
+	}
+
+	u64 fingerprint(std::span<const Archive::CdDataLocFileInfo> filesInfo)
+	{
+		Hash::Fnv1a hash;
+
+		for (const auto& fileInfo : filesInfo)
+		{
+			hash.update(fileInfo.position);
+			hash.update(fileInfo.size);
+		}
+
+		return hash.value();
+	}
+
+	const Version* detectVersion(std::span<const Archive::CdDataLocFileInfo> filesInfo)
+	{
+		const auto signature{ layoutSignature(filesInfo) };
+
+		for (const auto& version : versions)
+		{
+			if (version.layoutSignature == signature)
+			{
+				return &version;
+			}
+		}
+
+		return nullptr;
+	}
+
+	const Version* findVersion(u32 nbFiles)
+	{
+		for (const auto& version : versions)
+		{
+			if (version.filesPath.size() == nbFiles)
+			{
+				return &version;
+			}
+		}
+
+		return nullptr;
+	}
+
+	const Version* findVersion(std::span<const Archive::CdDataLocFileInfo> filesInfo)
+	{
+		if (const auto* const version{ detectVersion(filesInfo) })
+		{
+			return version;
+		}
+
+		// Entries flagged differently than the path table, the number of files is the only hint left
+		return findVersion(static_cast<u32>(filesInfo.size()));
+	}
+
+	const Version& version(u32 nbFiles)
+	{
+		if (const auto* const version{ findVersion(nbFiles) })
+		{
+			return *version;
+		}
+
+		throw std::runtime_error{ "Invalid number of files" };
+	}
+
+	const Version& version(std::span<const Archive::CdDataLocFileInfo> filesInfo)
+	{
+		if (const auto* const version{ findVersion(filesInfo) })
+		{
+			return *version;
+		}
+
+		throw std::runtime_error{ "Invalid number of files" };
+	}
+
+	const PathView& filesPath(u32 nbFiles)
+	{
+		return version(nbFiles).filesPath;
 	}
 }
\ No newline at end of file
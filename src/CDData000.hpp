@@ -1,10 +1,99 @@
 #pragma once
 
+#include "Archive.hpp"
 #include "Types.hpp"
 
-#include <vector>
+#include <array>
+#include <cstddef>
+#include <optional>
+#include <span>
+#include <string_view>
 
 namespace CDData000
 {
-	std::vector<const char*> filesPath(u32 nbFiles);
+	// Paths of every version, a path id is its index in this table
+	inline constexpr u32 nbIds{ 5249 };
+	inline constexpr std::size_t maxPathSize{ 64 };
+
+	using PathBuffer = std::array<char, maxPathSize>;
+
+	std::string_view path(u32 id, PathBuffer& buffer);
+	std::optional<u32> find(std::string_view path);
+	u32 directory(u32 id);
+	u32 nbDirectories();
+	std::string_view directoryPath(u32 directory);
+	// Ids of a directory sorted by file name
+	std::span<const u16> directoryIds(u32 directory);
+
+	// Paths of a game version, a view over the paths of every version that skips the missing ones
+	class PathView
+	{
+	public:
+		constexpr PathView(std::span<const u16> missing, std::size_t size)
+			: m_missing{ missing }, m_size{ size }
+		{
+		}
+
+		std::string_view path(u32 index, PathBuffer& buffer) const
+		{
+			return CDData000::path(id(index), buffer);
+		}
+
+		constexpr u32 id(u32 index) const
+		{
+			for (const auto missingId : m_missing)
+			{
+				if (missingId > index)
+				{
+					break;
+				}
+				++index;
+			}
+			return index;
+		}
+
+		constexpr std::optional<u32> index(u32 id) const
+		{
+			u32 index{ id };
+
+			for (const auto missingId : m_missing)
+			{
+				if (missingId == id)
+				{
+					return std::nullopt;
+				}
+				else if (missingId < id)
+				{
+					--index;
+				}
+			}
+			return index;
+		}
+
+		constexpr std::size_t size() const
+		{
+			return m_size;
+		}
+	private:
+		std::span<const u16> m_missing;
+		std::size_t m_size;
+	};
+
+	struct Version
+	{
+		const char* name;
+		PathView filesPath;
+		u64 layoutSignature;
+	};
+
+	// Hash of the sizes and positions, identifies a dump
+	u64 fingerprint(std::span<const Archive::CdDataLocFileInfo> filesInfo);
+	// Matches the number of entries and their container flags against the known versions
+	const Version* detectVersion(std::span<const Archive::CdDataLocFileInfo> filesInfo);
+	// Falls back to the number of files when the layout isn't recognized, nullptr for unknown versions
+	const Version* findVersion(std::span<const Archive::CdDataLocFileInfo> filesInfo);
+	const Version* findVersion(u32 nbFiles);
+	const Version& version(std::span<const Archive::CdDataLocFileInfo> filesInfo);
+	const Version& version(u32 nbFiles);
+	const PathView& filesPath(u32 nbFiles);
 }
\ No newline at end of file
@@ -0,0 +1,346 @@
+#include "Catalog.hpp"
+
+#include "Archive.hpp"
+#include "CDData000.hpp"
+#include "Hash.hpp"
+#include "Magic.hpp"
+#include "Parallel.hpp"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace Catalog
+{
+	template <typename T>
+	static std::span<const T> table(std::span<const char> data, u64 offset, u64 size)
+	{
+		if (offset % alignof(T) != 0 || offset > data.size() || size > (data.size() - offset) / sizeof(T))
+		{
+			throw std::runtime_error{ "Catalog is invalid" };
+		}
+
+		return { reinterpret_cast<const T*>(data.data() + offset), static_cast<std::size_t>(size) };
+	}
+
+	std::vector<char> build(const std::filesystem::path& src, bool generic)
+	{
+		const auto filesInfo{ Archive::readLoc(Archive::find(src, Archive::cdDataLocFilename)) };
+		const MappedFile cdData000{ Archive::find(src, Archive::cdData000Filename) };
+		const auto* const version{ generic ? nullptr : CDData000::findVersion(filesInfo) };
+		const auto nbEntries{ static_cast<u32>(filesInfo.size()) };
+
+		std::vector<Entry> entries(nbEntries);
+
+		Parallel::forEach(nbEntries, [&](std::size_t i)
+		{
+			const auto& fileInfo{ filesInfo[i] };
+			const auto position{ static_cast<u64>(fileInfo.position) * Archive::sectorSize };
+
+			if (position + fileInfo.size > cdData000.size())
+			{
+				throw std::runtime_error{ fmt::format("\"{}\" is truncated", Archive::cdData000Filename) };
+			}
+
+			const auto* const data{ cdData000.data() + position };
+			const auto type{ Magic::type(data, std::min<std::size_t>(fileInfo.size, Magic::headerSize), fileInfo.isABin) };
+			auto& entry{ entries[i] };
+
+			entry = { fileInfo.position, fileInfo.size, fileInfo.nbSectors, fileInfo.isABin, Hash::xxh64(data, fileInfo.size), 0, 0, 0, {} };
+			std::copy(type.begin(), type.end(), entry.type.begin());
+		});
+
+		// Paths and directories, named as the unpacker does
+		std::string names;
+		std::vector<std::pair<std::string, std::vector<u32>>> directories;
+
+		if (version)
+		{
+			std::vector<u32> entryDirectories(CDData000::nbDirectories(), nbEntries);
+
+			for (u32 directory{}; directory < CDData000::nbDirectories(); ++directory)
+			{
+				std::vector<u32> indices;
+
+				for (const auto id : CDData000::directoryIds(directory))
+				{
+					if (const auto index{ version->filesPath.index(id) }; index && *index < nbEntries)
+					{
+						indices.push_back(*index);
+					}
+				}
+
+				if (!indices.empty())
+				{
+					directories.emplace_back(CDData000::directoryPath(directory), std::move(indices));
+				}
+			}
+		}
+		else
+		{
+			std::vector<u32> indices(nbEntries);
+
+			for (u32 i{}; i < nbEntries; ++i)
+			{
+				indices[i] = i;
+			}
+
+			directories.emplace_back(fmt::format("{}/", Archive::unknownDirectory), std::move(indices));
+		}
+
+		std::sort(directories.begin(), directories.end(), [](const auto& lhs, const auto& rhs) { return lhs.first < rhs.first; });
+
+		std::vector<Directory> directoriesTable;
+		std::vector<u32> order;
+		order.reserve(nbEntries);
+		CDData000::PathBuffer pathBuffer;
+
+		for (const auto& [directoryPath, indices] : directories)
+		{
+			directoriesTable.push_back({ static_cast<u32>(names.size()), static_cast<u32>(directoryPath.size()),
+				static_cast<u32>(order.size()), static_cast<u32>(indices.size()) });
+			names += directoryPath;
+
+			for (const auto index : indices)
+			{
+				auto& entry{ entries[index] };
+				const auto path{ version ? std::string{ version->filesPath.path(index, pathBuffer) } :
+					fmt::format("{}{:05}{}", directoryPath, index, entry.type.data()) };
+
+				entry.pathOffset = static_cast<u32>(names.size());
+				entry.pathSize = static_cast<u16>(path.size());
+				entry.directory = static_cast<u16>(directoriesTable.size() - 1);
+				names += path;
+				order.push_back(index);
+			}
+		}
+
+		if (order.size() != nbEntries)
+		{
+			throw std::runtime_error{ "Some entries have no path" };
+		}
+
+		// Header, entries, directories, order and names, every table aligned on its type
+		Header header{ magic, formatVersion, nbEntries, static_cast<u32>(directoriesTable.size()), static_cast<u32>(names.size()),
+			cdData000.size(), CDData000::fingerprint(filesInfo), 0, 0, 0, 0, {} };
+		header.entriesOffset = sizeof(Header);
+		header.directoriesOffset = header.entriesOffset + entries.size() * sizeof(Entry);
+		header.orderOffset = header.directoriesOffset + directoriesTable.size() * sizeof(Directory);
+		header.namesOffset = header.orderOffset + order.size() * sizeof(u32);
+
+		const std::string_view gameVersion{ version ? version->name : "Unknown" };
+		std::copy_n(gameVersion.begin(), std::min(gameVersion.size(), header.gameVersion.size() - 1), header.gameVersion.begin());
+
+		std::vector<char> catalog(header.namesOffset + names.size());
+		std::memcpy(catalog.data(), &header, sizeof(header));
+		std::memcpy(catalog.data() + header.entriesOffset, entries.data(), entries.size() * sizeof(Entry));
+		std::memcpy(catalog.data() + header.directoriesOffset, directoriesTable.data(), directoriesTable.size() * sizeof(Directory));
+		std::memcpy(catalog.data() + header.orderOffset, order.data(), order.size() * sizeof(u32));
+		std::memcpy(catalog.data() + header.namesOffset, names.data(), names.size());
+
+		return catalog;
+	}
+
+	View::View(std::span<const char> data)
+		: m_data{ data }
+	{
+		validate();
+	}
+
+	View::View(const std::filesystem::path& path)
+		: m_file{ std::in_place, path }, m_data{ m_file->data(), m_file->size() }
+	{
+		validate();
+	}
+
+	void View::validate()
+	{
+		if (m_data.size() < sizeof(Header) || reinterpret_cast<std::uintptr_t>(m_data.data()) % alignof(Header) != 0)
+		{
+			throw std::runtime_error{ "Catalog is invalid" };
+		}
+
+		const auto& header{ this->header() };
+
+		if (header.magic != magic)
+		{
+			throw std::runtime_error{ "Catalog is invalid" };
+		}
+		else if (header.formatVersion != formatVersion)
+		{
+			throw std::runtime_error{ fmt::format("Catalog format {} is not supported", header.formatVersion) };
+		}
+
+		const auto entries{ table<Entry>(m_data, header.entriesOffset, header.nbEntries) };
+		const auto directories{ table<Directory>(m_data, header.directoriesOffset, header.nbDirectories) };
+		const auto order{ table<u32>(m_data, header.orderOffset, header.nbEntries) };
+		table<char>(m_data, header.namesOffset, header.namesSize);
+
+		// Ranges inside the tables are checked once so lookups don't have to
+		const auto isInNames{ [&](u64 offset, u64 size) { return offset <= header.namesSize && size <= header.namesSize - offset; } };
+
+		for (const auto& entry : entries)
+		{
+			if (!isInNames(entry.pathOffset, entry.pathSize) || entry.directory >= header.nbDirectories)
+			{
+				throw std::runtime_error{ "Catalog is invalid" };
+			}
+		}
+
+		for (const auto& directory : directories)
+		{
+			if (!isInNames(directory.pathOffset, directory.pathSize) || directory.firstEntry > header.nbEntries ||
+				directory.nbEntries > header.nbEntries - directory.firstEntry)
+			{
+				throw std::runtime_error{ "Catalog is invalid" };
+			}
+		}
+
+		for (const auto index : order)
+		{
+			if (index >= header.nbEntries)
+			{
+				throw std::runtime_error{ "Catalog is invalid" };
+			}
+		}
+	}
+
+	const Header& View::header() const
+	{
+		return *reinterpret_cast<const Header*>(m_data.data());
+	}
+
+	std::span<const Entry> View::entries() const
+	{
+		return { reinterpret_cast<const Entry*>(m_data.data() + header().entriesOffset), header().nbEntries };
+	}
+
+	std::span<const Directory> View::directories() const
+	{
+		return { reinterpret_cast<const Directory*>(m_data.data() + header().directoriesOffset), header().nbDirectories };
+	}
+
+	std::span<const u32> View::order() const
+	{
+		return { reinterpret_cast<const u32*>(m_data.data() + header().orderOffset), header().nbEntries };
+	}
+
+	std::string_view View::path(const Entry& entry) const
+	{
+		return { m_data.data() + header().namesOffset + entry.pathOffset, entry.pathSize };
+	}
+
+	std::string_view View::path(const Directory& directory) const
+	{
+		return { m_data.data() + header().namesOffset + directory.pathOffset, directory.pathSize };
+	}
+
+	std::string_view View::type(const Entry& entry) const
+	{
+		return { entry.type.data(), static_cast<std::size_t>(std::find(entry.type.begin(), entry.type.end(), '\0') - entry.type.begin()) };
+	}
+
+	std::string_view View::gameVersion() const
+	{
+		const auto& gameVersion{ header().gameVersion };
+		return { gameVersion.data(), static_cast<std::size_t>(std::find(gameVersion.begin(), gameVersion.end(), '\0') - gameVersion.begin()) };
+	}
+
+	std::optional<u32> View::find(std::string_view path) const
+	{
+		const auto directoryPath{ path.substr(0, path.rfind('/') + 1) };
+		const auto directories{ this->directories() };
+		const auto directory{ std::lower_bound(directories.begin(), directories.end(), directoryPath,
+			[this](const Directory& directory, std::string_view path)
+			{
+				return this->path(directory) < path;
+			}) };
+
+		if (directory == directories.end() || this->path(*directory) != directoryPath)
+		{
+			return std::nullopt;
+		}
+
+		const auto entries{ this->entries() };
+		const auto indices{ order().subspan(directory->firstEntry, directory->nbEntries) };
+		const auto index{ std::lower_bound(indices.begin(), indices.end(), path,
+			[&](u32 index, std::string_view path)
+			{
+				return this->path(entries[index]) < path;
+			}) };
+
+		if (index == indices.end() || this->path(entries[*index]) != path)
+		{
+			return std::nullopt;
+		}
+
+		return *index;
+	}
+
+	static std::string jsonString(std::string_view string)
+	{
+		std::string result{ "\"" };
+
+		for (const auto c : string)
+		{
+			if (c == '"' || c == '\\')
+			{
+				result += '\\';
+				result += c;
+			}
+			else if (static_cast<u8>(c) < 0x20)
+			{
+				result += fmt::format("\\u{:04x}", static_cast<u8>(c));
+			}
+			else
+			{
+				result += c;
+			}
+		}
+
+		return result += '"';
+	}
+
+	void exportJson(const View& catalog, const std::filesystem::path& dest)
+	{
+		const auto& header{ catalog.header() };
+		std::ofstream file{ dest, std::ofstream::binary };
+
+		file << fmt::format("{{\n\t\"formatVersion\": {},\n\t\"gameVersion\": {},\n\t\"fingerprint\": \"{:016X}\",\n\t\"archiveSize\": {},\n",
+			header.formatVersion, jsonString(catalog.gameVersion()), header.fingerprint, header.archiveSize);
+
+		file << "\t\"directories\": [\n";
+		for (std::size_t i{}; const auto& directory : catalog.directories())
+		{
+			file << fmt::format("\t\t{{ \"path\": {}, \"firstEntry\": {}, \"nbEntries\": {} }}{}\n", jsonString(catalog.path(directory)),
+				directory.firstEntry, directory.nbEntries, ++i < header.nbDirectories ? "," : "");
+		}
+		file << "\t],\n";
+
+		file << "\t\"entries\": [\n";
+		for (u32 i{}; const auto& entry : catalog.entries())
+		{
+			file << fmt::format("\t\t{{ \"index\": {}, \"path\": {}, \"position\": {}, \"size\": {}, \"nbSectors\": {}, \"isABin\": {}, "
+				"\"type\": {}, \"hash\": \"{:016X}\" }}{}\n", i, jsonString(catalog.path(entry)), entry.position, entry.size, entry.nbSectors,
+				entry.isABin != 0, jsonString(catalog.type(entry)), entry.hash, i + 1 < header.nbEntries ? "," : "");
+			++i;
+		}
+		file << "\t]\n}\n";
+	}
+
+	void exportCsv(const View& catalog, const std::filesystem::path& dest)
+	{
+		std::ofstream file{ dest, std::ofstream::binary };
+		file << "index,path,position,size,nbSectors,isABin,type,hash\n";
+
+		for (u32 i{}; const auto& entry : catalog.entries())
+		{
+			file << fmt::format("{},{},{},{},{},{},{},{:016X}\n", i++, catalog.path(entry), entry.position, entry.size,
+				entry.nbSectors, entry.isABin, catalog.type(entry), entry.hash);
+		}
+	}
+}
\ No newline at end of file
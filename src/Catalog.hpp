@@ -0,0 +1,92 @@
+#pragma once
+
+#include "File.hpp"
+#include "Types.hpp"
+
+#include <array>
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// Binary description of an archive (entries, paths, directories, hashes, types) usable in place from a mapping
+namespace Catalog
+{
+	inline constexpr std::array<char, 8> magic{ 'J', 'C', '2', 'C', 'A', 'T', 'L', 'G' };
+	inline constexpr u32 formatVersion{ 1 };
+
+	// Little endian, offsets are relative to the start of the catalog
+	struct Header
+	{
+		std::array<char, 8> magic;
+		u32 formatVersion;
+		u32 nbEntries;
+		u32 nbDirectories;
+		u32 namesSize;
+		u64 archiveSize;
+		// CDData000::fingerprint of the LOC
+		u64 fingerprint;
+		u64 entriesOffset;
+		u64 directoriesOffset;
+		// Entry indices sorted by directory then by file name
+		u64 orderOffset;
+		u64 namesOffset;
+		std::array<char, 16> gameVersion;
+	};
+
+	struct Entry
+	{
+		u32 position;
+		u32 size;
+		u32 nbSectors;
+		s32 isABin;
+		// XXH64 of the content
+		u64 hash;
+		u32 pathOffset;
+		u16 pathSize;
+		u16 directory;
+		std::array<char, 8> type;
+	};
+
+	// Range of the sorted entry indices
+	struct Directory
+	{
+		u32 pathOffset;
+		u32 pathSize;
+		u32 firstEntry;
+		u32 nbEntries;
+	};
+
+	static_assert(sizeof(Header) == 88 && sizeof(Entry) == 40 && sizeof(Directory) == 16);
+
+	// Catalog of the CDDATA.000 and CDDATA.LOC of src, generic names for unknown versions or when asked
+	std::vector<char> build(const std::filesystem::path& src, bool generic = false);
+
+	class View
+	{
+	public:
+		// Only the header and the bounds of the tables are checked
+		explicit View(std::span<const char> data);
+		explicit View(const std::filesystem::path& path);
+
+		const Header& header() const;
+		std::span<const Entry> entries() const;
+		std::span<const Directory> directories() const;
+		std::span<const u32> order() const;
+		std::string_view path(const Entry& entry) const;
+		std::string_view path(const Directory& directory) const;
+		std::string_view type(const Entry& entry) const;
+		std::string_view gameVersion() const;
+		std::optional<u32> find(std::string_view path) const;
+	private:
+		void validate();
+
+		std::optional<MappedFile> m_file;
+		std::span<const char> m_data;
+	};
+
+	void exportJson(const View& catalog, const std::filesystem::path& dest);
+	void exportCsv(const View& catalog, const std::filesystem::path& dest);
+}
\ No newline at end of file
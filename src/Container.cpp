@@ -0,0 +1,236 @@
+#include "Container.hpp"
+
+#include "File.hpp"
+#include "Magic.hpp"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <bit>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+namespace Container
+{
+	// Beyond this a count is more likely the first bytes of something else
+	static constexpr u32 maxMembers{ 4096 };
+
+	static u32 readU32(std::span<const char> data, std::size_t offset)
+	{
+		u32 value;
+		std::memcpy(&value, data.data() + offset, sizeof(value));
+		return value;
+	}
+
+	static void writeU32(std::span<char> data, std::size_t offset, u32 value)
+	{
+		std::memcpy(data.data() + offset, &value, sizeof(value));
+	}
+
+	static u32 tableEntrySize(Table table)
+	{
+		return table == Table::Offsets ? 4 : 8;
+	}
+
+	bool isContainer(const std::filesystem::path& path)
+	{
+		const auto extension{ path.extension() };
+		return extension == ".bin" || extension == ".hbin";
+	}
+
+	static std::optional<Layout> detect(std::span<const char> data, Table table)
+	{
+		if (data.size() < 8)
+		{
+			return std::nullopt;
+		}
+
+		const auto nbMembers{ readU32(data, 0) };
+		const auto tableEnd{ 4 + static_cast<u64>(nbMembers) * tableEntrySize(table) };
+
+		if (nbMembers == 0 || nbMembers > maxMembers || tableEnd > data.size())
+		{
+			return std::nullopt;
+		}
+
+		Layout layout{ table, {}, 0 };
+		u32 offsetsBits{};
+
+		for (u32 i{}; i < nbMembers; ++i)
+		{
+			const auto offset{ readU32(data, 4 + i * tableEntrySize(table)) };
+
+			// Members follow the table in order without overlapping
+			if (offset < tableEnd || offset > data.size() || (i && offset < layout.members.back().offset + layout.members.back().size))
+			{
+				return std::nullopt;
+			}
+
+			if (table == Table::Offsets && i)
+			{
+				layout.members.back().size = offset - layout.members.back().offset;
+			}
+
+			const auto size{ table == Table::Offsets ? 0 : readU32(data, 8 + i * 8) };
+			if (size > data.size() - offset)
+			{
+				return std::nullopt;
+			}
+
+			layout.members.push_back({ offset, size });
+			offsetsBits |= offset;
+		}
+
+		if (table == Table::Offsets)
+		{
+			layout.members.back().size = static_cast<u32>(data.size()) - layout.members.back().offset;
+		}
+
+		layout.alignment = std::min<u32>(offsetsBits ? u32{ 1 } << std::countr_zero(offsetsBits) : 2048, 2048);
+		return layout;
+	}
+
+	std::optional<Layout> detect(std::span<const char> data)
+	{
+		// Pairs are stricter, the size of every member is checked against the offsets
+		if (auto layout{ detect(data, Table::OffsetsSizes) })
+		{
+			return layout;
+		}
+		return detect(data, Table::Offsets);
+	}
+
+	void unpack(std::span<const char> data, const Layout& layout, const std::filesystem::path& directory)
+	{
+		std::filesystem::create_directories(directory);
+
+		const auto headerSize{ layout.members.front().offset };
+		std::ofstream
+			index{ directory / indexFilename },
+			header{ directory / headerFilename, std::ofstream::binary },
+			gaps{ directory / gapsFilename, std::ofstream::binary };
+
+		header.write(data.data(), headerSize);
+		index << fmt::format("table {}\nsize {}\nalignment {}\n", layout.table == Table::Offsets ? "offsets" : "offsetsSizes",
+			data.size(), layout.alignment);
+
+		for (std::size_t i{}; i < layout.members.size(); ++i)
+		{
+			const auto& member{ layout.members[i] };
+			const auto end{ static_cast<u64>(member.offset) + member.size };
+			const auto next{ i + 1 < layout.members.size() ? layout.members[i + 1].offset : data.size() };
+			const auto name{ fmt::format("{:03}{}", i, Magic::type(data.data() + member.offset,
+				std::min<std::size_t>(member.size, Magic::headerSize), false)) };
+
+			std::ofstream file{ directory / name, std::ofstream::binary };
+			file.write(data.data() + member.offset, member.size);
+			gaps.write(data.data() + end, next - end);
+
+			index << fmt::format("member {} {} {} {}\n", member.offset, member.size, next - end, name);
+		}
+	}
+
+	std::vector<char> repack(const std::filesystem::path& directory)
+	{
+		std::ifstream
+			index{ directory / indexFilename },
+			gaps{ directory / gapsFilename, std::ifstream::binary };
+
+		if (!index)
+		{
+			throw std::runtime_error{ fmt::format("Can't find \"{}\" in \"{}\"", indexFilename, directory.string()) };
+		}
+
+		std::vector<char> data(std::filesystem::file_size(directory / headerFilename));
+		std::ifstream{ directory / headerFilename, std::ifstream::binary }.read(data.data(), data.size());
+
+		std::string line, type, tableName;
+		u64 originalSize{};
+		u32 alignment{ 1 }, nbMembers{};
+		bool moved{};
+
+		while (std::getline(index, line))
+		{
+			std::istringstream stream{ line };
+			stream >> type;
+
+			if (type == "table")
+			{
+				stream >> tableName;
+			}
+			else if (type == "size")
+			{
+				stream >> originalSize;
+			}
+			else if (type == "alignment")
+			{
+				stream >> alignment;
+			}
+			else if (type == "member")
+			{
+				u32 offset, originalMemberSize, gapSize;
+				std::string name;
+				stream >> offset >> originalMemberSize >> gapSize >> name;
+
+				const auto table{ tableName == "offsets" ? Table::Offsets : Table::OffsetsSizes };
+				const auto entryOffset{ 4 + nbMembers * tableEntrySize(table) };
+
+				if (!stream || !std::has_single_bit(alignment) || entryOffset + tableEntrySize(table) > data.size())
+				{
+					throw std::runtime_error{ fmt::format("\"{}\" is invalid", (directory / indexFilename).string()) };
+				}
+
+				const auto memberPath{ directory / name };
+				const auto size{ std::filesystem::file_size(memberPath) };
+
+				// Once a member moved or changed size, the next ones are packed on the alignment
+				const auto position{ moved ? alignUp(data.size(), alignment) : offset };
+				if (!moved && position < data.size())
+				{
+					throw std::runtime_error{ fmt::format("\"{}\" is invalid", (directory / indexFilename).string()) };
+				}
+
+				data.resize(position + size);
+				std::ifstream{ memberPath, std::ifstream::binary }.read(data.data() + position, size);
+
+				std::vector<char> gap(gapSize);
+				gaps.read(gap.data(), gap.size());
+
+				moved = moved || size != originalMemberSize;
+				if (!moved)
+				{
+					data.insert(data.end(), gap.begin(), gap.end());
+				}
+
+				if (position + size > std::numeric_limits<u32>::max())
+				{
+					throw std::runtime_error{ fmt::format("\"{}\" exceeds the size limit", directory.string()) };
+				}
+
+				writeU32(data, entryOffset, static_cast<u32>(position));
+				if (table == Table::OffsetsSizes)
+				{
+					writeU32(data, entryOffset + 4, static_cast<u32>(size));
+				}
+				++nbMembers;
+			}
+		}
+
+		if (nbMembers == 0 || readU32(data, 0) != nbMembers)
+		{
+			throw std::runtime_error{ fmt::format("\"{}\" is invalid", (directory / indexFilename).string()) };
+		}
+
+		// A packed container ends on the alignment like the original one did
+		if (moved && originalSize % alignment == 0)
+		{
+			data.resize(alignUp(data.size(), alignment));
+		}
+
+		return data;
+	}
+}
\ No newline at end of file
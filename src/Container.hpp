@@ -0,0 +1,49 @@
+#pragma once
+
+#include "Types.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <span>
+#include <vector>
+
+// .bin and .hbin files holding other files behind an offset table, unpacked to a directory named after them
+namespace Container
+{
+	inline constexpr auto
+		directorySuffix{ ".d" },
+		indexFilename{ "CONTAINER.IDX" },
+		headerFilename{ "CONTAINER.HDR" },
+		gapsFilename{ "CONTAINER.GAP" };
+
+	enum class Table
+	{
+		// u32 count, then u32 offset of every member
+		Offsets,
+		// u32 count, then u32 offset and u32 size of every member
+		OffsetsSizes
+	};
+
+	struct Member
+	{
+		u32 offset;
+		u32 size;
+	};
+
+	struct Layout
+	{
+		Table table;
+		std::vector<Member> members;
+		// Largest power of two up to a sector dividing every offset, edited members are aligned on it
+		u32 alignment;
+	};
+
+	bool isContainer(const std::filesystem::path& path);
+	// None when the data isn't a well formed table, such files are left as they are
+	std::optional<Layout> detect(std::span<const char> data);
+
+	// Members, then the header, the bytes between members and the index needed to rebuild data bit-exactly
+	void unpack(std::span<const char> data, const Layout& layout, const std::filesystem::path& directory);
+	// Unchanged members keep their offsets, the ones after a resized member are packed on the alignment
+	std::vector<char> repack(const std::filesystem::path& directory);
+}
\ No newline at end of file
@@ -0,0 +1,333 @@
+#include "Daemon.hpp"
+
+#include "Archive.hpp"
+#include "Parallel.hpp"
+#include "Search.hpp"
+
+#include "fmt/format.h"
+
+#include <charconv>
+#include <cerrno>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+Daemon::Daemon(const std::filesystem::path& src, bool generic)
+	: m_catalogData{ Catalog::build(src, generic) }, m_catalog{ m_catalogData },
+	m_cdData000{ Archive::find(src, Archive::cdData000Filename) }, m_cdData000Fd{ -1 }, m_searchSlots{ 1 }
+{
+#ifdef _WIN32
+	throw std::runtime_error{ "The daemon needs Unix sockets, not available on Windows" };
+#else
+	m_cdData000Fd = ::open(Archive::find(src, Archive::cdData000Filename).c_str(), O_RDONLY | O_CLOEXEC);
+
+	if (m_cdData000Fd == -1)
+	{
+		throw std::runtime_error{ fmt::format("Can't open \"{}\": {}", Archive::cdData000Filename, std::strerror(errno)) };
+	}
+#endif
+}
+
+Daemon::~Daemon()
+{
+#ifndef _WIN32
+	if (m_cdData000Fd != -1)
+	{
+		::close(m_cdData000Fd);
+	}
+#endif
+}
+
+std::optional<u32> Daemon::entry(std::string_view token) const
+{
+	u32 index;
+	const auto [end, error]{ std::from_chars(token.data(), token.data() + token.size(), index) };
+
+	if (error == std::errc{} && end == token.data() + token.size())
+	{
+		return index < m_catalog.header().nbEntries ? std::optional{ index } : std::nullopt;
+	}
+
+	return m_catalog.find(token);
+}
+
+#ifndef _WIN32
+// Whole buffers, false when the client is gone
+static bool send(int fd, std::span<iovec> iov)
+{
+	while (!iov.empty())
+	{
+		msghdr message{};
+		message.msg_iov = iov.data();
+		message.msg_iovlen = iov.size();
+		const auto nbSent{ ::sendmsg(fd, &message, MSG_NOSIGNAL) };
+
+		if (nbSent == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		else if (nbSent == -1)
+		{
+			return false;
+		}
+
+		// Short send, sent buffers are dropped and the partially sent one is advanced
+		auto size{ static_cast<std::size_t>(nbSent) };
+
+		while (!iov.empty() && size >= iov.front().iov_len)
+		{
+			size -= iov.front().iov_len;
+			iov = iov.subspan(1);
+		}
+
+		if (!iov.empty())
+		{
+			iov.front().iov_base = static_cast<char*>(iov.front().iov_base) + size;
+			iov.front().iov_len -= size;
+		}
+	}
+
+	return true;
+}
+#endif
+
+bool Daemon::reply(int fd, std::string_view request) const
+{
+#ifdef _WIN32
+	return false;
+#else
+	std::istringstream stream{ std::string{ request } };
+	std::string command, token;
+	stream >> command >> token;
+
+	const auto entries{ m_catalog.entries() };
+	const auto sendText{ [&](std::string_view status, std::string_view text)
+	{
+		const auto header{ status == "OK" ? fmt::format("OK {}\n", text.size()) : fmt::format("ERR {}\n", text) };
+		iovec iov[]{ { const_cast<char*>(header.data()), header.size() }, { const_cast<char*>(text.data()), status == "OK" ? text.size() : 0 } };
+		return send(fd, iov);
+	}};
+
+	if (command == "list")
+	{
+		std::string text;
+
+		for (u32 i{}; i < entries.size(); ++i)
+		{
+			text += fmt::format("{} {} {}\n", i, m_catalog.path(entries[i]), entries[i].size);
+		}
+		return sendText("OK", text);
+	}
+	else if (command == "stat" || command == "read")
+	{
+		const auto index{ entry(token) };
+
+		if (!index)
+		{
+			return sendText("ERR", fmt::format("\"{}\" is not an entry", token));
+		}
+
+		const auto& entry{ entries[*index] };
+
+		if (command == "stat")
+		{
+			return sendText("OK", fmt::format("{} {} {} {} {} {} {} {:016X}\n", *index, m_catalog.path(entry), entry.position, entry.size,
+				entry.nbSectors, entry.isABin, m_catalog.type(entry), entry.hash));
+		}
+
+		u64 offset{}, size{ entry.size };
+		stream >> offset >> size;
+		offset = std::min<u64>(offset, entry.size);
+		size = std::min<u64>(size, entry.size - offset);
+
+		const auto position{ static_cast<u64>(entry.position) * Archive::sectorSize + offset };
+
+		if (position + size > m_cdData000.size())
+		{
+			return sendText("ERR", fmt::format("\"{}\" is truncated", Archive::cdData000Filename));
+		}
+		else if (size < fdReadSize)
+		{
+			return sendText("OK", { m_cdData000.data() + position, static_cast<std::size_t>(size) });
+		}
+
+		// Big reads: the client reads the range itself from the descriptor
+		const auto header{ fmt::format("FD {} {}\n", position, size) };
+		iovec iov{ const_cast<char*>(header.data()), header.size() };
+		alignas(cmsghdr) char control[CMSG_SPACE(sizeof(int))]{};
+
+		msghdr message{};
+		message.msg_iov = &iov;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+
+		auto* const controlMessage{ CMSG_FIRSTHDR(&message) };
+		controlMessage->cmsg_level = SOL_SOCKET;
+		controlMessage->cmsg_type = SCM_RIGHTS;
+		controlMessage->cmsg_len = CMSG_LEN(sizeof(int));
+		std::memcpy(CMSG_DATA(controlMessage), &m_cdData000Fd, sizeof(int));
+
+		// The header is small enough for a single message with its descriptor
+		return ::sendmsg(fd, &message, MSG_NOSIGNAL) == static_cast<ssize_t>(header.size());
+	}
+	else if (command == "search")
+	{
+		std::string hex{ token }, rest;
+		std::getline(stream, rest);
+		hex += rest;
+
+		std::vector<Search::Pattern> patterns;
+
+		try
+		{
+			patterns.push_back(Search::hex(hex));
+		}
+		catch (const std::exception& e)
+		{
+			return sendText("ERR", e.what());
+		}
+
+		std::vector<std::vector<Search::Match>> matches(entries.size());
+		m_searchSlots.acquire();
+
+		try
+		{
+			Parallel::forEach(entries.size(), [&](std::size_t i)
+			{
+				const auto position{ static_cast<u64>(entries[i].position) * Archive::sectorSize };
+
+				if (position + entries[i].size <= m_cdData000.size())
+				{
+					matches[i] = Search::find({ reinterpret_cast<const u8*>(m_cdData000.data()) + position, entries[i].size }, patterns);
+				}
+			});
+		}
+		catch (...)
+		{
+			m_searchSlots.release();
+			throw;
+		}
+
+		m_searchSlots.release();
+
+		std::string text;
+
+		for (u32 i{}; i < entries.size(); ++i)
+		{
+			for (const auto& match : matches[i])
+			{
+				text += fmt::format("{} {} {}\n", i, m_catalog.path(entries[i]), match.offset);
+			}
+		}
+		return sendText("OK", text);
+	}
+
+	return sendText("ERR", fmt::format("\"{}\" is not a request", command));
+#endif
+}
+
+void Daemon::serveClient(int fd) const
+{
+#ifndef _WIN32
+	std::string buffer;
+	char chunk[4096];
+
+	while (true)
+	{
+		const auto nbRead{ ::read(fd, chunk, sizeof(chunk)) };
+
+		if (nbRead == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		else if (nbRead <= 0)
+		{
+			break;
+		}
+
+		buffer.append(chunk, static_cast<std::size_t>(nbRead));
+
+		std::size_t start{};
+		for (auto end{ buffer.find('\n') }; end != std::string::npos; start = end + 1, end = buffer.find('\n', start))
+		{
+			if (!reply(fd, std::string_view{ buffer }.substr(start, end - start)))
+			{
+				::close(fd);
+				return;
+			}
+		}
+		buffer.erase(0, start);
+
+		// A line that never ends would grow the buffer without limit
+		if (buffer.size() > maxRequestSize)
+		{
+			const auto error{ fmt::format("ERR Request is longer than {} bytes\n", maxRequestSize) };
+			iovec iov[]{ { const_cast<char*>(error.data()), error.size() } };
+			send(fd, iov);
+			::shutdown(fd, SHUT_WR);
+
+			// Bytes left unread at close would reset the connection before the client reads the error
+			for (ssize_t nbDrained{}, nbRead; nbDrained < static_cast<ssize_t>(maxRequestSize) &&
+				(nbRead = ::recv(fd, chunk, sizeof(chunk), MSG_DONTWAIT)) > 0; nbDrained += nbRead)
+			{
+			}
+			break;
+		}
+	}
+
+	::close(fd);
+#endif
+}
+
+void Daemon::serve(const std::filesystem::path& socketPath)
+{
+#ifdef _WIN32
+	throw std::runtime_error{ "The daemon needs Unix sockets, not available on Windows" };
+#else
+	sockaddr_un address{};
+	address.sun_family = AF_UNIX;
+
+	if (socketPath.native().size() >= sizeof(address.sun_path))
+	{
+		throw std::runtime_error{ fmt::format("\"{}\" is too long for a socket path", socketPath.string()) };
+	}
+
+	std::strcpy(address.sun_path, socketPath.c_str());
+	std::filesystem::remove(socketPath);
+
+	const auto server{ ::socket(AF_UNIX, SOCK_STREAM, 0) };
+
+	if (server == -1 || ::bind(server, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == -1 || ::listen(server, SOMAXCONN) == -1)
+	{
+		throw std::runtime_error{ fmt::format("Can't listen on \"{}\": {}", socketPath.string(), std::strerror(errno)) };
+	}
+
+	fmt::print("Serving {} entries on \"{}\", Ctrl+C to stop\n", m_catalog.header().nbEntries, socketPath.string());
+	std::fflush(stdout);
+
+	while (true)
+	{
+		const auto client{ ::accept(server, nullptr, nullptr) };
+
+		if (client != -1)
+		{
+			std::thread{ &Daemon::serveClient, this, client }.detach();
+		}
+		else if (errno != EINTR && errno != ECONNABORTED)
+		{
+			throw std::runtime_error{ fmt::format("Can't accept on \"{}\": {}", socketPath.string(), std::strerror(errno)) };
+		}
+	}
+#endif
+}
\ No newline at end of file
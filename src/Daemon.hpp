@@ -0,0 +1,44 @@
+#pragma once
+
+#include "Catalog.hpp"
+#include "File.hpp"
+#include "Types.hpp"
+
+#include <filesystem>
+#include <optional>
+#include <semaphore>
+#include <string_view>
+#include <vector>
+
+// Entries of an archive mapped once and served over a Unix socket, one request per line:
+// "list", "stat [entry]", "read [entry] [offset] [size]" and "search [hex bytes]", an entry is an index or a path.
+// Replies are "OK [size]" then size bytes, "ERR [message]", or for big reads "FD [offset] [size]" with
+// a descriptor of CDDATA.000 attached (SCM_RIGHTS) to read the range from without copy
+class Daemon
+{
+public:
+	// Reads from this size up are handed over as a descriptor
+	static constexpr u64 fdReadSize{ 64 * 1024 };
+	// Clients sending longer lines are dropped
+	static constexpr std::size_t maxRequestSize{ 64 * 1024 };
+
+	Daemon(const std::filesystem::path& src, bool generic);
+	Daemon(const Daemon&) = delete;
+	Daemon& operator=(const Daemon&) = delete;
+	~Daemon();
+
+	// Every client is served by its own thread, never returns
+	[[noreturn]] void serve(const std::filesystem::path& socketPath);
+private:
+	void serveClient(int fd) const;
+	// False when the client is gone
+	bool reply(int fd, std::string_view request) const;
+	std::optional<u32> entry(std::string_view token) const;
+
+	std::vector<char> m_catalogData;
+	Catalog::View m_catalog;
+	MappedFile m_cdData000;
+	int m_cdData000Fd;
+	// Searches run over every thread one at a time, concurrent clients wait instead of multiplying the threads
+	mutable std::counting_semaphore<> m_searchSlots;
+};
\ No newline at end of file
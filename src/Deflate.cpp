@@ -0,0 +1,453 @@
+#include "Deflate.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+namespace Deflate
+{
+	static constexpr std::size_t
+		windowSize{ 32768 },
+		minMatch{ 3 },
+		maxMatch{ 258 },
+		maxChain{ 64 },
+		hashBits{ 15 };
+
+	static constexpr std::array<u16, 29> lengthBase
+	{
+		3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+	};
+
+	static constexpr std::array<u8, 29> lengthExtraBits
+	{
+		0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+	};
+
+	static constexpr std::array<u16, 30> distanceBase
+	{
+		1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577
+	};
+
+	static constexpr std::array<u8, 30> distanceExtraBits
+	{
+		0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+	};
+
+	// Deflate packs bits from the least significant one, Huffman codes from their most significant bit
+	class BitWriter
+	{
+	public:
+		explicit BitWriter(std::vector<u8>& output)
+			: m_output{ output }
+		{
+		}
+
+		void write(u32 value, u32 nbBits)
+		{
+			m_bits |= static_cast<u64>(value) << m_nbBits;
+			m_nbBits += nbBits;
+
+			while (m_nbBits >= 8)
+			{
+				m_output.push_back(static_cast<u8>(m_bits));
+				m_bits >>= 8;
+				m_nbBits -= 8;
+			}
+		}
+
+		void writeCode(u32 code, u32 nbBits)
+		{
+			u32 reversed{};
+			for (u32 i{}; i < nbBits; ++i)
+			{
+				reversed |= (code >> i & 1) << (nbBits - 1 - i);
+			}
+			write(reversed, nbBits);
+		}
+
+		void flush()
+		{
+			if (m_nbBits)
+			{
+				m_output.push_back(static_cast<u8>(m_bits));
+				m_bits = 0;
+				m_nbBits = 0;
+			}
+		}
+	private:
+		std::vector<u8>& m_output;
+		u64 m_bits{};
+		u32 m_nbBits{};
+	};
+
+	static void writeLiteral(BitWriter& writer, u32 value)
+	{
+		if (value < 144)
+		{
+			writer.writeCode(0x30 + value, 8);
+		}
+		else if (value < 256)
+		{
+			writer.writeCode(0x190 + value - 144, 9);
+		}
+		else if (value < 280)
+		{
+			writer.writeCode(value - 256, 7);
+		}
+		else
+		{
+			writer.writeCode(0xC0 + value - 280, 8);
+		}
+	}
+
+	static void writeMatch(BitWriter& writer, u32 length, u32 distance)
+	{
+		const auto lengthCode{ static_cast<u32>(std::upper_bound(lengthBase.begin(), lengthBase.end(), length) - lengthBase.begin() - 1) };
+		writeLiteral(writer, 257 + lengthCode);
+		writer.write(length - lengthBase[lengthCode], lengthExtraBits[lengthCode]);
+
+		const auto distanceCode{ static_cast<u32>(std::upper_bound(distanceBase.begin(), distanceBase.end(), distance) - distanceBase.begin() - 1) };
+		writer.writeCode(distanceCode, 5);
+		writer.write(distance - distanceBase[distanceCode], distanceExtraBits[distanceCode]);
+	}
+
+	static u32 hash(const u8* data)
+	{
+		u32 value;
+		std::memcpy(&value, data, sizeof(value));
+		return ((value & 0xFFFFFF) * 0x9E3779B1u) >> (32 - hashBits);
+	}
+
+	std::vector<u8> compress(std::span<const u8> data)
+	{
+		std::vector<u8> output;
+		output.reserve(data.size() / 2 + 64);
+		BitWriter writer{ output };
+
+		// Single final block with fixed codes
+		writer.write(1, 1);
+		writer.write(1, 2);
+
+		// Chains of previous positions with the same hash, -1 ends a chain
+		std::vector<s32> head(std::size_t{ 1 } << hashBits, -1);
+		std::vector<s32> previous(windowSize, -1);
+
+		const auto size{ data.size() };
+		const auto* const bytes{ data.data() };
+		std::size_t position{};
+
+		const auto insert{ [&](std::size_t position)
+		{
+			const auto h{ hash(bytes + position) };
+			previous[position % windowSize] = head[h];
+			head[h] = static_cast<s32>(position);
+		}};
+
+		while (position < size)
+		{
+			std::size_t bestLength{}, bestDistance{};
+
+			// Hashing reads 4 bytes, the last ones are always literals
+			if (position + 4 <= size)
+			{
+				const auto maxLength{ std::min(maxMatch, size - position) };
+				auto candidate{ head[hash(bytes + position)] };
+
+				for (std::size_t chain{}; candidate >= 0 && chain < maxChain; ++chain)
+				{
+					const auto distance{ position - static_cast<std::size_t>(candidate) };
+					if (distance > windowSize)
+					{
+						break;
+					}
+
+					std::size_t length{};
+					while (length < maxLength && bytes[candidate + length] == bytes[position + length])
+					{
+						++length;
+					}
+
+					if (length > bestLength)
+					{
+						bestLength = length;
+						bestDistance = distance;
+						if (length == maxLength)
+						{
+							break;
+						}
+					}
+
+					const auto next{ previous[candidate % windowSize] };
+					if (next >= candidate)
+					{
+						break;
+					}
+					candidate = next;
+				}
+			}
+
+			if (bestLength >= minMatch)
+			{
+				writeMatch(writer, static_cast<u32>(bestLength), static_cast<u32>(bestDistance));
+
+				for (const auto end{ position + bestLength }; position < end; ++position)
+				{
+					if (position + 4 <= size)
+					{
+						insert(position);
+					}
+				}
+			}
+			else
+			{
+				writeLiteral(writer, bytes[position]);
+
+				if (position + 4 <= size)
+				{
+					insert(position);
+				}
+				++position;
+			}
+		}
+
+		writeLiteral(writer, 256);
+		writer.flush();
+		return output;
+	}
+
+	class BitReader
+	{
+	public:
+		explicit BitReader(std::span<const u8> data)
+			: m_data{ data }
+		{
+		}
+
+		u32 read(u32 nbBits)
+		{
+			while (m_nbBits < nbBits)
+			{
+				if (m_position >= m_data.size())
+				{
+					throw std::runtime_error{ "Deflate stream is truncated" };
+				}
+				m_bits |= static_cast<u64>(m_data[m_position++]) << m_nbBits;
+				m_nbBits += 8;
+			}
+
+			const auto value{ static_cast<u32>(m_bits & ((u64{ 1 } << nbBits) - 1)) };
+			m_bits >>= nbBits;
+			m_nbBits -= nbBits;
+			return value;
+		}
+
+		// Stored blocks start on a byte boundary
+		std::span<const u8> readBytes(std::size_t size)
+		{
+			m_bits >>= m_nbBits % 8;
+			m_nbBits -= m_nbBits % 8;
+			m_position -= m_nbBits / 8;
+			m_bits = 0;
+			m_nbBits = 0;
+
+			if (m_position + size > m_data.size())
+			{
+				throw std::runtime_error{ "Deflate stream is truncated" };
+			}
+
+			const auto bytes{ m_data.subspan(m_position, size) };
+			m_position += size;
+			return bytes;
+		}
+	private:
+		std::span<const u8> m_data;
+		std::size_t m_position{};
+		u64 m_bits{};
+		u32 m_nbBits{};
+	};
+
+	// Canonical Huffman code decoded one bit at a time from the counts of each length
+	class Huffman
+	{
+	public:
+		static constexpr u32 maxBits{ 15 };
+
+		explicit Huffman(std::span<const u8> lengths)
+		{
+			for (const auto length : lengths)
+			{
+				++m_counts[length];
+			}
+			m_counts[0] = 0;
+
+			std::array<u16, maxBits + 1> offsets{};
+			for (u32 i{ 1 }; i < maxBits; ++i)
+			{
+				offsets[i + 1] = offsets[i] + m_counts[i];
+			}
+
+			m_symbols.resize(lengths.size());
+			for (u16 symbol{}; symbol < lengths.size(); ++symbol)
+			{
+				if (lengths[symbol])
+				{
+					m_symbols[offsets[lengths[symbol]]++] = symbol;
+				}
+			}
+		}
+
+		u32 decode(BitReader& reader) const
+		{
+			s32 code{}, first{}, index{};
+
+			for (u32 length{ 1 }; length <= maxBits; ++length)
+			{
+				code |= static_cast<s32>(reader.read(1));
+				const s32 count{ m_counts[length] };
+
+				if (code - count < first)
+				{
+					return m_symbols[index + code - first];
+				}
+
+				index += count;
+				first = (first + count) << 1;
+				code <<= 1;
+			}
+
+			throw std::runtime_error{ "Deflate stream is invalid" };
+		}
+	private:
+		std::array<u16, maxBits + 1> m_counts{};
+		std::vector<u16> m_symbols;
+	};
+
+	std::vector<u8> decompress(std::span<const u8> data, std::size_t sizeHint)
+	{
+		std::vector<u8> output;
+		output.reserve(sizeHint);
+		BitReader reader{ data };
+
+		static constexpr std::array<u8, 19> codeLengthsOrder{ 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+		static const auto fixedCodes{ []()
+		{
+			std::array<u8, 288 + 30> lengths;
+			std::fill(lengths.begin(), lengths.begin() + 144, 8);
+			std::fill(lengths.begin() + 144, lengths.begin() + 256, 9);
+			std::fill(lengths.begin() + 256, lengths.begin() + 280, 7);
+			std::fill(lengths.begin() + 280, lengths.begin() + 288, 8);
+			std::fill(lengths.begin() + 288, lengths.end(), 5);
+			return std::pair{ Huffman{ std::span{ lengths }.first(288) }, Huffman{ std::span{ lengths }.subspan(288) } };
+		}() };
+
+		for (bool last{}; !last;)
+		{
+			last = reader.read(1);
+			const auto type{ reader.read(2) };
+
+			if (type == 0)
+			{
+				const auto header{ reader.readBytes(4) };
+				const auto size{ static_cast<u32>(header[0] | header[1] << 8) };
+
+				if ((size ^ static_cast<u32>(header[2] | header[3] << 8)) != 0xFFFF)
+				{
+					throw std::runtime_error{ "Deflate stream is invalid" };
+				}
+
+				const auto bytes{ reader.readBytes(size) };
+				output.insert(output.end(), bytes.begin(), bytes.end());
+				continue;
+			}
+			else if (type == 3)
+			{
+				throw std::runtime_error{ "Deflate stream is invalid" };
+			}
+
+			std::optional<std::pair<Huffman, Huffman>> dynamicCodes;
+
+			if (type == 2)
+			{
+				const auto nbLiterals{ reader.read(5) + 257 }, nbDistances{ reader.read(5) + 1 }, nbCodeLengths{ reader.read(4) + 4 };
+
+				std::array<u8, 19> codeLengths{};
+				for (u32 i{}; i < nbCodeLengths; ++i)
+				{
+					codeLengths[codeLengthsOrder[i]] = static_cast<u8>(reader.read(3));
+				}
+
+				const Huffman codeLengthsCode{ codeLengths };
+				std::vector<u8> lengths;
+
+				while (lengths.size() < nbLiterals + nbDistances)
+				{
+					const auto symbol{ codeLengthsCode.decode(reader) };
+
+					if (symbol < 16)
+					{
+						lengths.push_back(static_cast<u8>(symbol));
+						continue;
+					}
+					else if (symbol == 16 && lengths.empty())
+					{
+						throw std::runtime_error{ "Deflate stream is invalid" };
+					}
+
+					const auto value{ symbol == 16 ? lengths.back() : u8{} };
+					const auto repeat{ symbol == 16 ? 3 + reader.read(2) : symbol == 17 ? 3 + reader.read(3) : 11 + reader.read(7) };
+					lengths.insert(lengths.end(), repeat, value);
+				}
+
+				if (lengths.size() != nbLiterals + nbDistances)
+				{
+					throw std::runtime_error{ "Deflate stream is invalid" };
+				}
+
+				dynamicCodes.emplace(Huffman{ std::span{ lengths }.first(nbLiterals) }, Huffman{ std::span{ lengths }.subspan(nbLiterals) });
+			}
+
+			const auto& [literals, distances]{ dynamicCodes ? *dynamicCodes : fixedCodes };
+
+			for (auto symbol{ literals.decode(reader) }; symbol != 256; symbol = literals.decode(reader))
+			{
+				if (symbol < 256)
+				{
+					output.push_back(static_cast<u8>(symbol));
+					continue;
+				}
+
+				symbol -= 257;
+				if (symbol >= lengthBase.size())
+				{
+					throw std::runtime_error{ "Deflate stream is invalid" };
+				}
+
+				const auto length{ lengthBase[symbol] + reader.read(lengthExtraBits[symbol]) };
+				const auto distanceSymbol{ distances.decode(reader) };
+
+				if (distanceSymbol >= distanceBase.size())
+				{
+					throw std::runtime_error{ "Deflate stream is invalid" };
+				}
+
+				const auto distance{ distanceBase[distanceSymbol] + reader.read(distanceExtraBits[distanceSymbol]) };
+
+				if (distance > output.size())
+				{
+					throw std::runtime_error{ "Deflate stream is invalid" };
+				}
+
+				// Copies byte by byte, a match can overlap the bytes it produces
+				for (auto from{ output.size() - distance }, end{ from + length }; from < end; ++from)
+				{
+					output.push_back(output[from]);
+				}
+			}
+		}
+
+		return output;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "Types.hpp"
+
+#include <span>
+#include <vector>
+
+// Raw deflate streams (RFC 1951)
+namespace Deflate
+{
+	// Greedy LZ77 over a 32 KiB window coded with the fixed Huffman codes
+	std::vector<u8> compress(std::span<const u8> data);
+	// Stored, fixed and dynamic blocks, throws on corrupted streams
+	std::vector<u8> decompress(std::span<const u8> data, std::size_t sizeHint = 0);
+}
\ No newline at end of file
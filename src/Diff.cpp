@@ -0,0 +1,77 @@
+#include "Diff.hpp"
+
+#include <algorithm>
+#include <bit>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace Diff
+{
+	// First offset in [offset, size) where lhs and rhs differ, size when they don't
+	static std::size_t mismatch(const char* lhs, const char* rhs, std::size_t offset, std::size_t size)
+	{
+#ifdef __SSE2__
+		for (; offset + 16 <= size; offset += 16)
+		{
+			const auto equal{ _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(lhs + offset)),
+				_mm_loadu_si128(reinterpret_cast<const __m128i*>(rhs + offset))) };
+			const auto mask{ static_cast<u32>(_mm_movemask_epi8(equal)) };
+
+			if (mask != 0xFFFF)
+			{
+				return offset + std::countr_one(mask);
+			}
+		}
+#endif
+		while (offset < size && lhs[offset] == rhs[offset])
+		{
+			++offset;
+		}
+		return offset;
+	}
+
+	std::vector<Range> ranges(std::span<const char> lhs, std::span<const char> rhs, u64 mergeGap)
+	{
+		std::vector<Range> ranges;
+
+		const auto add{ [&](u64 offset, u64 size)
+		{
+			if (!ranges.empty() && offset - (ranges.back().offset + ranges.back().size) <= mergeGap)
+			{
+				ranges.back().size = offset + size - ranges.back().offset;
+			}
+			else
+			{
+				ranges.push_back({ offset, size });
+			}
+		}};
+
+		const auto size{ std::min(lhs.size(), rhs.size()) };
+
+		for (auto offset{ mismatch(lhs.data(), rhs.data(), 0, size) }; offset < size; offset = mismatch(lhs.data(), rhs.data(), offset, size))
+		{
+			auto end{ offset + 1 };
+			while (end < size && lhs[end] != rhs[end])
+			{
+				++end;
+			}
+
+			add(offset, end - offset);
+			offset = end;
+		}
+
+		if (lhs.size() != rhs.size())
+		{
+			add(size, std::max(lhs.size(), rhs.size()) - size);
+		}
+
+		return ranges;
+	}
+
+	bool equal(std::span<const char> lhs, std::span<const char> rhs)
+	{
+		return lhs.size() == rhs.size() && mismatch(lhs.data(), rhs.data(), 0, lhs.size()) == lhs.size();
+	}
+}
\ No newline at end of file
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "Types.hpp"
+
+#include <span>
+#include <vector>
+
+// Byte ranges that differ between two versions of an entry
+namespace Diff
+{
+	struct Range
+	{
+		u64 offset;
+		u64 size;
+	};
+
+	// Ranges closer than mergeGap are merged, bytes past the end of the shorter one differ
+	std::vector<Range> ranges(std::span<const char> lhs, std::span<const char> rhs, u64 mergeGap = 16);
+	bool equal(std::span<const char> lhs, std::span<const char> rhs);
+}
\ No newline at end of file
@@ -0,0 +1,599 @@
+#include "File.hpp"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <stdexcept>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#ifdef __linux__
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#include <sys/sendfile.h>
+#endif
+
+static bool isSeekable(int fd)
+{
+#ifdef _WIN32
+	return _lseeki64(fd, 0, SEEK_CUR) != -1;
+#else
+	return ::lseek(fd, 0, SEEK_CUR) != -1;
+#endif
+}
+
+static bool isZero(const char* data, std::size_t size)
+{
+	std::size_t i{};
+#ifdef __SSE2__
+	auto accumulator{ _mm_setzero_si128() };
+
+	for (; i + 16 <= size; i += 16)
+	{
+		accumulator = _mm_or_si128(accumulator, _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i)));
+	}
+
+	if (_mm_movemask_epi8(_mm_cmpeq_epi8(accumulator, _mm_setzero_si128())) != 0xFFFF)
+	{
+		return false;
+	}
+#endif
+	for (; i < size; ++i)
+	{
+		if (data[i] != '\0')
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+File::File(const std::filesystem::path& path, Mode mode, bool direct)
+	: m_path{ path }, m_direct{ false }
+{
+#ifdef _WIN32
+	const auto flags{ mode == Mode::Read ? _O_RDONLY | _O_BINARY : mode == Mode::Update ? _O_RDWR | _O_BINARY :
+		_O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY };
+	m_fd = _wopen(path.c_str(), flags, _S_IREAD | _S_IWRITE);
+#else
+	const auto flags{ mode == Mode::Read ? O_RDONLY : mode == Mode::Update ? O_RDWR : O_WRONLY | O_CREAT | O_TRUNC };
+	m_fd = -1;
+
+#ifdef O_DIRECT
+	if (direct)
+	{
+		m_fd = ::open(path.c_str(), flags | O_DIRECT, 0666);
+		m_direct = m_fd != -1;
+	}
+#endif
+
+	if (m_fd == -1)
+	{
+		m_fd = ::open(path.c_str(), flags, 0666);
+	}
+#endif
+
+	if (m_fd == -1)
+	{
+		throw std::runtime_error{ fmt::format("Can't open \"{}\": {}", path.string(), std::strerror(errno)) };
+	}
+
+	if (direct && !m_direct)
+	{
+		fmt::print("Direct I/O is not supported for \"{}\", using buffered I/O\n", path.string());
+	}
+
+	m_seekable = ::isSeekable(m_fd);
+}
+
+File::File(File&& file) noexcept
+	: m_path{ std::move(file.m_path) }, m_fd{ file.m_fd }, m_direct{ file.m_direct }, m_seekable{ file.m_seekable }
+{
+	file.m_fd = -1;
+}
+
+File::File(int fd, const char* name)
+	: m_path{ name }, m_fd{ fd }, m_direct{ false }, m_seekable{ ::isSeekable(fd) }
+{
+	if (m_fd == -1)
+	{
+		throw std::runtime_error{ fmt::format("Can't open {}: {}", name, std::strerror(errno)) };
+	}
+
+#ifdef _WIN32
+	_setmode(m_fd, _O_BINARY);
+#endif
+}
+
+File::~File()
+{
+	if (m_fd != -1)
+	{
+#ifdef _WIN32
+		_close(m_fd);
+#else
+		::close(m_fd);
+#endif
+	}
+}
+
+File File::standardInput()
+{
+#ifdef _WIN32
+	return File{ _dup(0), "stdin" };
+#else
+	return File{ ::dup(0), "stdin" };
+#endif
+}
+
+File File::standardOutput()
+{
+	std::fflush(stdout);
+#ifdef _WIN32
+	File file{ _dup(1), "stdout" };
+	_dup2(2, 1);
+#else
+	File file{ ::dup(1), "stdout" };
+	::dup2(2, 1);
+#endif
+	return file;
+}
+
+std::size_t File::read(u64 offset, void* buffer, std::size_t size)
+{
+	auto* bufferPtr{ static_cast<char*>(buffer) };
+	std::size_t totalRead{};
+
+	while (totalRead < size)
+	{
+		const auto remaining{ size - totalRead };
+#ifdef _WIN32
+		if (m_seekable)
+		{
+			_lseeki64(m_fd, static_cast<s64>(offset + totalRead), SEEK_SET);
+		}
+		const auto nbRead{ _read(m_fd, bufferPtr + totalRead,
+			static_cast<unsigned>(std::min<std::size_t>(remaining, std::numeric_limits<int>::max()))) };
+#else
+		const auto nbRead{ m_seekable ?
+			::pread(m_fd, bufferPtr + totalRead, remaining, static_cast<off_t>(offset + totalRead)) :
+			::read(m_fd, bufferPtr + totalRead, remaining) };
+#endif
+		if (nbRead == 0)
+		{
+			break;
+		}
+		else if (nbRead < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			else if (errno == EINVAL && m_direct)
+			{
+				disableDirect();
+				continue;
+			}
+			throw std::runtime_error{ fmt::format("Can't read \"{}\": {}", m_path.string(), std::strerror(errno)) };
+		}
+
+		totalRead += static_cast<std::size_t>(nbRead);
+	}
+
+	return totalRead;
+}
+
+void File::write(u64 offset, const void* buffer, std::size_t size)
+{
+	const auto* bufferPtr{ static_cast<const char*>(buffer) };
+	std::size_t totalWritten{};
+
+	while (totalWritten < size)
+	{
+		const auto remaining{ size - totalWritten };
+#ifdef _WIN32
+		if (m_seekable)
+		{
+			_lseeki64(m_fd, static_cast<s64>(offset + totalWritten), SEEK_SET);
+		}
+		const auto nbWritten{ _write(m_fd, bufferPtr + totalWritten,
+			static_cast<unsigned>(std::min<std::size_t>(remaining, std::numeric_limits<int>::max()))) };
+#else
+		const auto nbWritten{ m_seekable ?
+			::pwrite(m_fd, bufferPtr + totalWritten, remaining, static_cast<off_t>(offset + totalWritten)) :
+			::write(m_fd, bufferPtr + totalWritten, remaining) };
+#endif
+		if (nbWritten < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			else if (errno == EINVAL && m_direct)
+			{
+				disableDirect();
+				continue;
+			}
+			throw std::runtime_error{ fmt::format("Can't write \"{}\": {}", m_path.string(), std::strerror(errno)) };
+		}
+
+		totalWritten += static_cast<std::size_t>(nbWritten);
+	}
+}
+
+void File::write(u64 offset, std::span<const Segment> segments)
+{
+#ifdef _WIN32
+	for (const auto& segment : segments)
+	{
+		write(offset, segment.data, segment.size);
+		offset += segment.size;
+	}
+#else
+	// IOV_MAX on Linux and macOS
+	static constexpr std::size_t maxIov{ 1024 };
+	iovec iov[maxIov];
+
+	while (!segments.empty())
+	{
+		const auto nbIov{ std::min(segments.size(), maxIov) };
+		std::size_t size{};
+
+		for (std::size_t i{}; i < nbIov; ++i)
+		{
+			iov[i] = { const_cast<void*>(segments[i].data), segments[i].size };
+			size += segments[i].size;
+		}
+
+		const auto nbWritten{ m_seekable ?
+			::pwritev(m_fd, iov, static_cast<int>(nbIov), static_cast<off_t>(offset)) :
+			::writev(m_fd, iov, static_cast<int>(nbIov)) };
+
+		if (nbWritten < 0)
+		{
+			if (errno == EINTR)
+			{
+				continue;
+			}
+			else if (errno == EINVAL && m_direct)
+			{
+				disableDirect();
+				continue;
+			}
+			throw std::runtime_error{ fmt::format("Can't write \"{}\": {}", m_path.string(), std::strerror(errno)) };
+		}
+
+		if (static_cast<std::size_t>(nbWritten) == size)
+		{
+			offset += size;
+			segments = segments.subspan(nbIov);
+			continue;
+		}
+
+		// Short write, the rest of the partially written segment is finished by the scalar path
+		auto remaining{ static_cast<std::size_t>(nbWritten) };
+		offset += remaining;
+
+		while (remaining >= segments.front().size)
+		{
+			remaining -= segments.front().size;
+			segments = segments.subspan(1);
+		}
+
+		const auto* const data{ static_cast<const char*>(segments.front().data) + remaining };
+		write(offset, data, segments.front().size - remaining);
+		offset += segments.front().size - remaining;
+		segments = segments.subspan(1);
+	}
+#endif
+}
+
+u64 File::writeSparse(u64 offset, const void* buffer, std::size_t size)
+{
+	if (!m_seekable || m_direct)
+	{
+		write(offset, buffer, size);
+		return 0;
+	}
+
+	const auto* const bytes{ static_cast<const char*>(buffer) };
+	const auto end{ offset + size };
+	auto dataStart{ offset };
+	u64 nbHoleBytes{};
+
+	for (auto position{ offset }; position < end;)
+	{
+		const auto blockEnd{ std::min(alignDown(position, directAlignment) + directAlignment, end) };
+
+		if (blockEnd - position == directAlignment && isZero(bytes + (position - offset), directAlignment))
+		{
+			if (position > dataStart)
+			{
+				write(dataStart, bytes + (dataStart - offset), static_cast<std::size_t>(position - dataStart));
+			}
+
+			dataStart = blockEnd;
+			nbHoleBytes += directAlignment;
+		}
+
+		position = blockEnd;
+	}
+
+	if (end > dataStart)
+	{
+		write(dataStart, bytes + (dataStart - offset), static_cast<std::size_t>(end - dataStart));
+	}
+	else if (nbHoleBytes && this->size() < end)
+	{
+		resize(end);
+	}
+
+	return nbHoleBytes;
+}
+
+std::size_t File::readSparse(u64 offset, void* buffer, std::size_t size)
+{
+#if !defined(_WIN32) && defined(SEEK_DATA)
+	if (m_seekable && !m_direct)
+	{
+		auto* const bytes{ static_cast<char*>(buffer) };
+		const auto end{ std::min(offset + size, this->size()) };
+
+		if (offset >= end)
+		{
+			return 0;
+		}
+
+		for (auto position{ offset }; position < end;)
+		{
+			auto dataStart{ static_cast<u64>(end) };
+
+			if (const auto result{ ::lseek(m_fd, static_cast<off_t>(position), SEEK_DATA) }; result != -1)
+			{
+				dataStart = std::min(static_cast<u64>(result), end);
+			}
+			else if (errno != ENXIO)
+			{
+				// Filesystems without hole reporting
+				return static_cast<std::size_t>(position - offset) + read(position, bytes + (position - offset), static_cast<std::size_t>(end - position));
+			}
+
+			std::memset(bytes + (position - offset), 0, static_cast<std::size_t>(dataStart - position));
+
+			if (dataStart == end)
+			{
+				break;
+			}
+
+			const auto result{ ::lseek(m_fd, static_cast<off_t>(dataStart), SEEK_HOLE) };
+			const auto dataEnd{ result == -1 ? end : std::min(static_cast<u64>(result), end) };
+			const auto dataSize{ static_cast<std::size_t>(dataEnd - dataStart) };
+			const auto nbRead{ read(dataStart, bytes + (dataStart - offset), dataSize) };
+
+			if (nbRead < dataSize)
+			{
+				return static_cast<std::size_t>(dataStart - offset) + nbRead;
+			}
+
+			position = dataEnd;
+		}
+
+		return static_cast<std::size_t>(end - offset);
+	}
+#endif
+	return read(offset, buffer, size);
+}
+
+void File::copy(u64 offset, File& src, u64 srcOffset, u64 size)
+{
+#ifdef __linux__
+	// Page cache is bypassed by direct I/O, only a user space copy can honor it
+	while (size && !src.m_direct)
+	{
+		auto srcPosition{ static_cast<off_t>(srcOffset) };
+		auto position{ static_cast<off_t>(offset) };
+		const auto nbCopied{ m_seekable ?
+			::copy_file_range(src.m_fd, &srcPosition, m_fd, &position, size, 0) :
+			::sendfile(m_fd, src.m_fd, &srcPosition, size) };
+
+		if (nbCopied > 0)
+		{
+			offset += static_cast<u64>(nbCopied);
+			srcOffset += static_cast<u64>(nbCopied);
+			size -= static_cast<u64>(nbCopied);
+			continue;
+		}
+		else if (nbCopied == 0)
+		{
+			throw std::runtime_error{ fmt::format("Can't read \"{}\": unexpected end of file", src.m_path.string()) };
+		}
+		else if (errno == EINTR)
+		{
+			continue;
+		}
+		else if (errno != EXDEV && errno != EINVAL && errno != ENOSYS && errno != EOPNOTSUPP)
+		{
+			throw std::runtime_error{ fmt::format("Can't copy \"{}\": {}", src.m_path.string(), std::strerror(errno)) };
+		}
+		break;
+	}
+#endif
+
+	if (size)
+	{
+		static constexpr std::size_t chunkSize{ 1024 * 1024 };
+		std::vector<char> buffer(static_cast<std::size_t>(std::min<u64>(size, chunkSize)));
+
+		while (size)
+		{
+			const auto toCopy{ static_cast<std::size_t>(std::min<u64>(size, buffer.size())) };
+			const auto nbRead{ src.read(srcOffset, buffer.data(), toCopy) };
+
+			if (nbRead < toCopy)
+			{
+				throw std::runtime_error{ fmt::format("Can't read \"{}\": unexpected end of file", src.m_path.string()) };
+			}
+
+			write(offset, buffer.data(), toCopy);
+			offset += toCopy;
+			srcOffset += toCopy;
+			size -= toCopy;
+		}
+	}
+}
+
+bool File::clone(File& src)
+{
+#ifdef __linux__
+	return ::ioctl(m_fd, FICLONE, src.m_fd) == 0;
+#else
+	return false;
+#endif
+}
+
+void File::resize(u64 size)
+{
+#ifdef _WIN32
+	const auto result{ _chsize_s(m_fd, static_cast<s64>(size)) == 0 ? 0 : -1 };
+#else
+	const auto result{ ::ftruncate(m_fd, static_cast<off_t>(size)) };
+#endif
+	if (result == -1)
+	{
+		throw std::runtime_error{ fmt::format("Can't resize \"{}\": {}", m_path.string(), std::strerror(errno)) };
+	}
+}
+
+u64 File::size() const
+{
+#ifdef _WIN32
+	struct _stat64 status;
+	const auto result{ _fstat64(m_fd, &status) };
+#else
+	struct stat status;
+	const auto result{ ::fstat(m_fd, &status) };
+#endif
+	if (result == -1)
+	{
+		throw std::runtime_error{ fmt::format("Can't stat \"{}\": {}", m_path.string(), std::strerror(errno)) };
+	}
+
+	return static_cast<u64>(status.st_size);
+}
+
+bool File::isDirect() const
+{
+	return m_direct;
+}
+
+bool File::isSeekable() const
+{
+	return m_seekable;
+}
+
+void File::disableDirect()
+{
+	// Some filesystems accept O_DIRECT at open time but refuse the transfer itself
+#if !defined(_WIN32) && defined(O_DIRECT)
+	::fcntl(m_fd, F_SETFL, ::fcntl(m_fd, F_GETFL) & ~O_DIRECT);
+#endif
+	m_direct = false;
+	fmt::print("Direct I/O was refused for \"{}\", using buffered I/O\n", m_path.string());
+}
+
+MappedFile::MappedFile(const std::filesystem::path& path)
+	: m_data{ nullptr }, m_size{}
+{
+	File file{ path, File::Mode::Read };
+	m_size = static_cast<std::size_t>(file.size());
+
+	if (m_size == 0)
+	{
+		return;
+	}
+
+#ifndef _WIN32
+	auto* const data{ ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, file.m_fd, 0) };
+
+	if (data != MAP_FAILED)
+	{
+		m_data = static_cast<const char*>(data);
+		return;
+	}
+#endif
+
+	m_buffer = std::make_unique_for_overwrite<char[]>(m_size);
+
+	if (file.read(0, m_buffer.get(), m_size) != m_size)
+	{
+		throw std::runtime_error{ fmt::format("Can't read \"{}\": unexpected end of file", path.string()) };
+	}
+	m_data = m_buffer.get();
+}
+
+MappedFile::MappedFile(MappedFile&& file) noexcept
+	: m_data{ file.m_data }, m_size{ file.m_size }, m_buffer{ std::move(file.m_buffer) }
+{
+	file.m_data = nullptr;
+	file.m_size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+#ifndef _WIN32
+	if (m_data && !m_buffer)
+	{
+		::munmap(const_cast<char*>(m_data), m_size);
+	}
+#endif
+}
+
+const char* MappedFile::data() const
+{
+	return m_data;
+}
+
+std::size_t MappedFile::size() const
+{
+	return m_size;
+}
+
+AlignedBuffer::AlignedBuffer(std::size_t size, std::size_t alignment)
+	: m_data{ static_cast<char*>(::operator new(size, std::align_val_t{ alignment })), Deleter{ alignment } }, m_size{ size }
+{
+}
+
+char* AlignedBuffer::data() const
+{
+	return m_data.get();
+}
+
+std::size_t AlignedBuffer::size() const
+{
+	return m_size;
+}
+
+void AlignedBuffer::Deleter::operator()(char* ptr) const
+{
+	::operator delete(ptr, std::align_val_t{ alignment });
+}
\ No newline at end of file
@@ -0,0 +1,114 @@
+#pragma once
+
+#include "Types.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <memory>
+#include <span>
+
+class File
+{
+public:
+	enum class Mode
+	{
+		Read,
+		Write,
+		// Existing file read and written in place
+		Update
+	};
+
+	struct Segment
+	{
+		const void* data;
+		std::size_t size;
+	};
+
+	// Alignment required by O_DIRECT for offsets, sizes and buffers on every common block device
+	static constexpr auto directAlignment{ 4096u };
+
+	File(const std::filesystem::path& path, Mode mode, bool direct = false);
+	File(File&& file) noexcept;
+	File(const File&) = delete;
+	File& operator=(const File&) = delete;
+	~File();
+
+	static File standardInput();
+	// Takes over stdout for binary data, text printed afterwards goes to stderr
+	static File standardOutput();
+
+	// Offsets are ignored by pipes, they are read and written sequentially
+	std::size_t read(u64 offset, void* buffer, std::size_t size);
+	void write(u64 offset, const void* buffer, std::size_t size);
+	void write(u64 offset, std::span<const Segment> segments);
+	// Zero blocks aligned on directAlignment in the file are skipped and left as holes, for files just created,
+	// returns the size of the holes
+	u64 writeSparse(u64 offset, const void* buffer, std::size_t size);
+	// Holes (SEEK_DATA / SEEK_HOLE) are filled with zeros without being read
+	std::size_t readSparse(u64 offset, void* buffer, std::size_t size);
+	// Kernel side copy (copy_file_range, sendfile) when available
+	void copy(u64 offset, File& src, u64 srcOffset, u64 size);
+	// Copy on write clone of the whole src (FICLONE), false when the filesystem can't share extents
+	bool clone(File& src);
+	void resize(u64 size);
+	u64 size() const;
+	bool isDirect() const;
+	bool isSeekable() const;
+private:
+	friend class MappedFile;
+
+	File(int fd, const char* name);
+
+	void disableDirect();
+
+	std::filesystem::path m_path;
+	int m_fd;
+	bool m_direct;
+	bool m_seekable;
+};
+
+// Read only mapping of a whole file, read into memory where mmap isn't available
+class MappedFile
+{
+public:
+	explicit MappedFile(const std::filesystem::path& path);
+	MappedFile(MappedFile&& file) noexcept;
+	MappedFile(const MappedFile&) = delete;
+	MappedFile& operator=(const MappedFile&) = delete;
+	~MappedFile();
+
+	const char* data() const;
+	std::size_t size() const;
+private:
+	const char* m_data;
+	std::size_t m_size;
+	std::unique_ptr<char[]> m_buffer;
+};
+
+class AlignedBuffer
+{
+public:
+	explicit AlignedBuffer(std::size_t size, std::size_t alignment = File::directAlignment);
+
+	char* data() const;
+	std::size_t size() const;
+private:
+	struct Deleter
+	{
+		std::size_t alignment;
+		void operator()(char* ptr) const;
+	};
+
+	std::unique_ptr<char[], Deleter> m_data;
+	std::size_t m_size;
+};
+
+constexpr u64 alignDown(u64 value, u64 alignment)
+{
+	return value & ~(alignment - 1);
+}
+
+constexpr u64 alignUp(u64 value, u64 alignment)
+{
+	return alignDown(value + alignment - 1, alignment);
+}
\ No newline at end of file
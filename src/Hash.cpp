@@ -0,0 +1,99 @@
+#include "Hash.hpp"
+
+namespace Hash
+{
+	Sha256 sha256(const void* data, std::size_t size)
+	{
+		static constexpr u32 k[64]
+		{
+			0x428A2F98, 0x71374491, 0xB5C0FBCF, 0xE9B5DBA5, 0x3956C25B, 0x59F111F1, 0x923F82A4, 0xAB1C5ED5,
+			0xD807AA98, 0x12835B01, 0x243185BE, 0x550C7DC3, 0x72BE5D74, 0x80DEB1FE, 0x9BDC06A7, 0xC19BF174,
+			0xE49B69C1, 0xEFBE4786, 0x0FC19DC6, 0x240CA1CC, 0x2DE92C6F, 0x4A7484AA, 0x5CB0A9DC, 0x76F988DA,
+			0x983E5152, 0xA831C66D, 0xB00327C8, 0xBF597FC7, 0xC6E00BF3, 0xD5A79147, 0x06CA6351, 0x14292967,
+			0x27B70A85, 0x2E1B2138, 0x4D2C6DFC, 0x53380D13, 0x650A7354, 0x766A0ABB, 0x81C2C92E, 0x92722C85,
+			0xA2BFE8A1, 0xA81A664B, 0xC24B8B70, 0xC76C51A3, 0xD192E819, 0xD6990624, 0xF40E3585, 0x106AA070,
+			0x19A4C116, 0x1E376C08, 0x2748774C, 0x34B0BCB5, 0x391C0CB3, 0x4ED8AA4A, 0x5B9CCA4F, 0x682E6FF3,
+			0x748F82EE, 0x78A5636F, 0x84C87814, 0x8CC70208, 0x90BEFFFA, 0xA4506CEB, 0xBEF9A3F7, 0xC67178F2
+		};
+
+		u32 state[8]{ 0x6A09E667, 0xBB67AE85, 0x3C6EF372, 0xA54FF53A, 0x510E527F, 0x9B05688C, 0x1F83D9AB, 0x5BE0CD19 };
+
+		const auto compress{ [&](const u8* block)
+		{
+			u32 w[64];
+
+			for (u32 i{}; i < 16; ++i)
+			{
+				w[i] = static_cast<u32>(block[i * 4]) << 24 | block[i * 4 + 1] << 16 | block[i * 4 + 2] << 8 | block[i * 4 + 3];
+			}
+
+			for (u32 i{ 16 }; i < 64; ++i)
+			{
+				const auto s0{ std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3) };
+				const auto s1{ std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10) };
+				w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+			}
+
+			auto [a, b, c, d, e, f, g, h]{ state };
+
+			for (u32 i{}; i < 64; ++i)
+			{
+				const auto t1{ h + (std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25)) + ((e & f) ^ (~e & g)) + k[i] + w[i] };
+				const auto t2{ (std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22)) + ((a & b) ^ (a & c) ^ (b & c)) };
+				h = g;
+				g = f;
+				f = e;
+				e = d + t1;
+				d = c;
+				c = b;
+				b = a;
+				a = t1 + t2;
+			}
+
+			state[0] += a;
+			state[1] += b;
+			state[2] += c;
+			state[3] += d;
+			state[4] += e;
+			state[5] += f;
+			state[6] += g;
+			state[7] += h;
+		}};
+
+		const auto* const bytes{ static_cast<const u8*>(data) };
+		std::size_t offset{};
+
+		for (; offset + 64 <= size; offset += 64)
+		{
+			compress(bytes + offset);
+		}
+
+		// Last block padded with 0x80, zeros and the size in bits, big endian
+		u8 last[128]{};
+		const auto remaining{ size - offset };
+		std::memcpy(last, bytes + offset, remaining);
+		last[remaining] = 0x80;
+
+		const auto lastSize{ remaining < 56 ? 64u : 128u };
+		const auto nbBits{ static_cast<u64>(size) * 8 };
+
+		for (u32 i{}; i < 8; ++i)
+		{
+			last[lastSize - 1 - i] = static_cast<u8>(nbBits >> i * 8);
+		}
+
+		for (u32 i{}; i < lastSize; i += 64)
+		{
+			compress(last + i);
+		}
+
+		Sha256 digest;
+
+		for (u32 i{}; i < 32; ++i)
+		{
+			digest[i] = static_cast<u8>(state[i / 4] >> (24 - i % 4 * 8));
+		}
+
+		return digest;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "Types.hpp"
+
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstring>
+
+namespace Hash
+{
+	class Fnv1a
+	{
+	public:
+		constexpr void update(const void* data, std::size_t size)
+		{
+			const auto* const bytes{ static_cast<const u8*>(data) };
+			for (std::size_t i{}; i < size; ++i)
+			{
+				update(bytes[i]);
+			}
+		}
+
+		constexpr void update(u8 byte)
+		{
+			m_value = (m_value ^ byte) * prime;
+		}
+
+		constexpr void update(u32 value)
+		{
+			for (u32 i{}; i < 4; ++i)
+			{
+				update(static_cast<u8>(value >> i * 8));
+			}
+		}
+
+		constexpr u64 value() const
+		{
+			return m_value;
+		}
+	private:
+		static constexpr u64
+			offsetBasis{ 0xCBF29CE484222325 },
+			prime{ 0x100000001B3 };
+
+		u64 m_value{ offsetBasis };
+	};
+
+	// XXH64, fast content hash of entries
+	inline u64 xxh64(const void* data, std::size_t size, u64 seed = 0)
+	{
+		static constexpr u64
+			prime1{ 0x9E3779B185EBCA87 },
+			prime2{ 0xC2B2AE3D27D4EB4F },
+			prime3{ 0x165667B19E3779F9 },
+			prime4{ 0x85EBCA77C2B2AE63 },
+			prime5{ 0x27D4EB2F165667C5 };
+
+		const auto read64{ [](const u8* ptr) { u64 value; std::memcpy(&value, ptr, sizeof(value)); return value; } };
+		const auto read32{ [](const u8* ptr) { u32 value; std::memcpy(&value, ptr, sizeof(value)); return value; } };
+		const auto round{ [](u64 accumulator, u64 input) { return std::rotl(accumulator + input * prime2, 31) * prime1; } };
+		const auto merge{ [&](u64 accumulator, u64 value) { return (accumulator ^ round(0, value)) * prime1 + prime4; } };
+
+		const auto* ptr{ static_cast<const u8*>(data) };
+		const auto* const end{ ptr + size };
+		u64 hash;
+
+		if (size >= 32)
+		{
+			u64 v1{ seed + prime1 + prime2 }, v2{ seed + prime2 }, v3{ seed }, v4{ seed - prime1 };
+
+			for (; ptr + 32 <= end; ptr += 32)
+			{
+				v1 = round(v1, read64(ptr));
+				v2 = round(v2, read64(ptr + 8));
+				v3 = round(v3, read64(ptr + 16));
+				v4 = round(v4, read64(ptr + 24));
+			}
+
+			hash = std::rotl(v1, 1) + std::rotl(v2, 7) + std::rotl(v3, 12) + std::rotl(v4, 18);
+			hash = merge(hash, v1);
+			hash = merge(hash, v2);
+			hash = merge(hash, v3);
+			hash = merge(hash, v4);
+		}
+		else
+		{
+			hash = seed + prime5;
+		}
+
+		hash += size;
+
+		for (; ptr + 8 <= end; ptr += 8)
+		{
+			hash = std::rotl(hash ^ round(0, read64(ptr)), 27) * prime1 + prime4;
+		}
+
+		if (ptr + 4 <= end)
+		{
+			hash = std::rotl(hash ^ read32(ptr) * prime1, 23) * prime2 + prime3;
+			ptr += 4;
+		}
+
+		for (; ptr < end; ++ptr)
+		{
+			hash = std::rotl(hash ^ *ptr * prime5, 11) * prime1;
+		}
+
+		hash ^= hash >> 33;
+		hash *= prime2;
+		hash ^= hash >> 29;
+		hash *= prime3;
+		hash ^= hash >> 32;
+		return hash;
+	}
+
+	using Sha256 = std::array<u8, 32>;
+
+	// SHA-256, for content addressing where collisions must not happen
+	Sha256 sha256(const void* data, std::size_t size);
+}
\ No newline at end of file
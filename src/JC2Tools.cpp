@@ -1,34 +1,60 @@
 #include "JC2Tools.hpp"
 
+#include "Archive.hpp"
+#include "ArchiveWriter.hpp"
+#include "Batch.hpp"
 #include "CDData000.hpp"
+#include "Catalog.hpp"
+#include "Container.hpp"
+#include "Daemon.hpp"
+#include "Diff.hpp"
+#include "File.hpp"
+#include "Hash.hpp"
+#include "Layout.hpp"
+#include "Magic.hpp"
+#include "Merkle.hpp"
+#include "Parallel.hpp"
+#include "Png.hpp"
+#include "ReadPlanner.hpp"
+#include "Search.hpp"
+#include "SectorIndex.hpp"
+#include "Store.hpp"
+#include "Tar.hpp"
+#include "Tim2.hpp"
+#include "Trace.hpp"
 #include "Types.hpp"
+#include "Watcher.hpp"
 
 #include "fmt/format.h"
 
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdio>
 #include <cstring>
 #include <fstream>
+#include <iostream>
 #include <limits>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <semaphore>
+#include <sstream>
 #include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_set>
+#include <utility>
 #include <vector>
 
 namespace JC2Tools
 {
-	static constexpr auto
-		sectorSize{ 2048u },
-		locHeaderSize{ 4u };
+	using namespace Archive;
 
 	static constexpr auto
-		cdData000Filename{ "CDDATA.000" },
-		cdDataLocFilename{ "CDDATA.LOC" },
-		dataDirectory{ "data" };
-
-	struct CdDataLocFileInfo
-	{
-		u32 position;
-		u32 size;
-		u32 nbSectors;
-		s32 isABin;
-	};
+		genericIndexFilename{ "CDDATA.IDX" },
+		genericGapsFilename{ "CDDATA.GAP" };
 
 	struct PathSize
 	{
@@ -36,104 +62,499 @@ namespace JC2Tools
 		std::size_t size;
 	};
 
-	void unpacker(const std::filesystem::path& src, const std::filesystem::path& dest)
+	// Entries of unknown versions are named by index and sniffed type, the index keeps everything
+	// else needed to rebuild the archive bit-exactly: LOC fields, archive size and non-zero bytes between entries
+	static std::vector<std::string> unpackGenericIndex(const std::filesystem::path& cdData000Path,
+		File& cdData000, std::span<const CdDataLocFileInfo> filesInfo, const std::filesystem::path& dest)
+	{
+		const auto extensions{ Magic::extensions(cdData000Path, filesInfo) };
+		const auto unknownPath{ fmt::format("{}/{}", dest.string(), unknownDirectory) };
+		std::filesystem::create_directories(unknownPath);
+
+		std::ofstream
+			index{ fmt::format("{}/{}", unknownPath, genericIndexFilename) },
+			gaps{ fmt::format("{}/{}", unknownPath, genericGapsFilename), std::ofstream::binary };
+
+		const auto archiveSize{ cdData000.size() };
+		index << fmt::format("size {}\n", archiveSize);
+
+		std::vector<std::string> filesName(filesInfo.size());
+
+		for (std::size_t i{}; i < filesInfo.size(); ++i)
+		{
+			const auto& fileInfo{ filesInfo[i] };
+			filesName[i] = fmt::format("{:05}{}", i, extensions[i]);
+			index << fmt::format("entry {} {} {} {} {}\n", fileInfo.position, fileInfo.size, fileInfo.nbSectors, fileInfo.isABin, filesName[i]);
+		}
+
+		std::vector<std::pair<u64, u64>> covered;
+		covered.reserve(filesInfo.size());
+
+		for (const auto& fileInfo : filesInfo)
+		{
+			const auto position{ static_cast<u64>(fileInfo.position) * sectorSize };
+			covered.emplace_back(position, position + fileInfo.size);
+		}
+
+		std::sort(covered.begin(), covered.end());
+		covered.emplace_back(archiveSize, archiveSize);
+
+		std::vector<char> buffer;
+		u64 gapStart{};
+
+		for (const auto& [start, end] : covered)
+		{
+			if (start > gapStart)
+			{
+				const auto gapEnd{ std::min(start, archiveSize) };
+				buffer.resize(static_cast<std::size_t>(gapEnd - gapStart));
+				cdData000.read(gapStart, buffer.data(), buffer.size());
+
+				if (std::any_of(buffer.begin(), buffer.end(), [](char c) { return c != '\0'; }))
+				{
+					index << fmt::format("gap {} {}\n", gapStart, buffer.size());
+					gaps.write(buffer.data(), buffer.size());
+				}
+			}
+
+			gapStart = std::max(gapStart, end);
+		}
+
+		return filesName;
+	}
+
+	// Files counted once per container directory, its members are a single file of the archive
+	static u32 countFiles(const std::filesystem::path& dataPath)
+	{
+		u32 nbFiles{};
+
+		for (auto it{ std::filesystem::recursive_directory_iterator{ dataPath } }; it != std::filesystem::recursive_directory_iterator{}; ++it)
+		{
+			if (it->is_directory() && std::filesystem::is_regular_file(it->path() / Container::indexFilename))
+			{
+				it.disable_recursion_pending();
+				++nbFiles;
+			}
+			else if (it->is_regular_file())
+			{
+				++nbFiles;
+			}
+		}
+
+		return nbFiles;
+	}
+
+	// Containers unpacked to a directory are rebuilt in parallel into filesData
+	static void repackContainers(std::span<const PathSize> filesPathSize, std::span<std::vector<char>> filesData)
 	{
-		const std::filesystem::path cdData000Path{ fmt::format("{}/{}", src.string(), cdData000Filename) };
+		std::vector<u32> containers;
+
+		for (u32 i{}; i < filesPathSize.size(); ++i)
+		{
+			const auto& path{ filesPathSize[i].path };
+
+			if (Container::isContainer(path) && !std::filesystem::exists(path) &&
+				std::filesystem::is_directory(path.string() + Container::directorySuffix))
+			{
+				containers.push_back(i);
+			}
+		}
 
-		if (!std::filesystem::is_regular_file(cdData000Path))
+		Parallel::forEach(containers.size(), [&](std::size_t i)
 		{
-			throw std::runtime_error{ fmt::format("Can't find \"{}\" in \"{}\"", cdData000Filename, src.string()) };
+			const auto index{ containers[i] };
+			filesData[index] = Container::repack(filesPathSize[index].path.string() + Container::directorySuffix);
+		});
+
+		if (!containers.empty())
+		{
+			fmt::print("{} containers rebuilt\n", containers.size());
+		}
+	}
+
+	template <typename... Args>
+	static void progress(const Options& options, fmt::format_string<Args...> format, Args&&... args)
+	{
+		if (!options.quiet)
+		{
+			fmt::print(format, std::forward<Args>(args)...);
 		}
+	}
 
-		const std::filesystem::path cdDataLocPath{ fmt::format("{}/{}", src.string(), cdDataLocFilename) };
+	// TIM2 files with edited PNGs (named as by texturesToPng) re-encoded in memory into filesData, returns their number
+	static u32 encodeTextures(const std::filesystem::path& texturesPath, std::span<const PathSize> filesPathSize,
+		const CDData000::PathView& filesPath, std::span<std::vector<char>> filesData)
+	{
+		std::vector<u32> candidates;
 
-		if (!std::filesystem::is_regular_file(cdDataLocPath))
+		for (u32 i{}; i < filesPathSize.size(); ++i)
 		{
-			throw std::runtime_error{ fmt::format("Can't find \"{}\" in \"{}\"", cdDataLocFilename, src.string()) };
+			if (filesPathSize[i].path.extension() == ".tm2" && filesData[i].empty())
+			{
+				candidates.push_back(i);
+			}
 		}
 
+		std::atomic<u32> nbTextures{};
+
+		Parallel::forEach(candidates.size(), [&](std::size_t i)
+		{
+			const auto index{ candidates[i] };
+			CDData000::PathBuffer pathBuffer;
+			std::filesystem::path pngPath{ fmt::format("{}/{}", texturesPath.string(), filesPath.path(index, pathBuffer)) };
+			pngPath.replace_extension(".png");
+
+			if (!std::filesystem::is_regular_file(pngPath))
+			{
+				return;
+			}
+
+			const auto& path{ filesPathSize[index].path };
+			std::vector<char> data(std::filesystem::file_size(path));
+			std::ifstream file{ path, std::ifstream::binary };
+			file.read(data.data(), data.size());
+
+			if (!Tim2::isTim2(data))
+			{
+				return;
+			}
+
+			const auto pictures{ Tim2::pictures(data) };
+
+			for (u32 j{}; j < pictures.size(); ++j)
+			{
+				pngPath.replace_extension(j ? fmt::format(".{}.png", j) : ".png");
+
+				if (Tim2::isSupported(pictures[j].header) && std::filesystem::is_regular_file(pngPath))
+				{
+					const auto image{ Png::read(pngPath) };
+
+					try
+					{
+						Tim2::encode(data, pictures[j], image.pixels);
+					}
+					catch (const std::exception& e)
+					{
+						throw std::runtime_error{ fmt::format("\"{}\": {}", pngPath.string(), e.what()) };
+					}
+				}
+			}
+
+			filesData[index] = std::move(data);
+			++nbTextures;
+		});
+
+		return nbTextures;
+	}
+
+	static void repackGeneric(const std::filesystem::path& unknownPath, const std::filesystem::path& dest)
+	{
 		std::ifstream
-			cdData000{ cdData000Path, std::ifstream::binary },
-			cdDataLoc{ cdDataLocPath, std::ifstream::binary };
+			index{ fmt::format("{}/{}", unknownPath.string(), genericIndexFilename) },
+			gaps{ fmt::format("{}/{}", unknownPath.string(), genericGapsFilename), std::ifstream::binary };
 
-		u32 nbFiles;
-		cdDataLoc.read((char*)&nbFiles, sizeof(nbFiles));
-		const auto locFileInfoSize{ nbFiles * sizeof(CdDataLocFileInfo) };
+		std::filesystem::create_directories(dest);
+		File cdData000{ fmt::format("{}/{}", dest.string(), cdData000Filename), File::Mode::Write };
+
+		u64 archiveSize{};
+		std::vector<CdDataLocFileInfo> filesInfo;
+		std::vector<std::string> filesName;
+		std::vector<char> buffer;
+		std::string line, type;
 
-		if (std::filesystem::file_size(cdDataLocPath) != locFileInfoSize + locHeaderSize)
+		// Gaps are written as they are read, entries once every gap is down so an edited file that grew into
+		// the padding after it isn't overwritten by the old bytes
+
+		while (std::getline(index, line))
 		{
-			throw std::runtime_error{ fmt::format("\"{}\" is invalid", cdDataLocFilename) };
+			std::istringstream stream{ line };
+			stream >> type;
+
+			if (type == "size")
+			{
+				stream >> archiveSize;
+			}
+			else if (type == "entry")
+			{
+				auto& fileInfo{ filesInfo.emplace_back() };
+				stream >> fileInfo.position >> fileInfo.size >> fileInfo.nbSectors >> fileInfo.isABin >> filesName.emplace_back();
+			}
+			else if (type == "gap")
+			{
+				u64 gapPosition, gapSize;
+				stream >> gapPosition >> gapSize;
+
+				buffer.resize(static_cast<std::size_t>(gapSize));
+				gaps.read(buffer.data(), buffer.size());
+				cdData000.write(gapPosition, buffer.data(), buffer.size());
+			}
+
+			if (!stream)
+			{
+				throw std::runtime_error{ fmt::format("\"{}\" is invalid", genericIndexFilename) };
+			}
 		}
 
-		std::vector<CdDataLocFileInfo> filesInfo(nbFiles);
-		cdDataLoc.read((char*)filesInfo.data(), locFileInfoSize);
+		for (u32 i{}; i < filesInfo.size(); ++i)
+		{
+			auto& fileInfo{ filesInfo[i] };
+			const auto filePath{ fmt::format("{}/{}", unknownPath.string(), filesName[i]) };
+			const auto fileSize{ std::filesystem::file_size(filePath) };
 
-		const auto maxFileSizeElem{ std::max_element(filesInfo.begin(), filesInfo.end(),
-			[](const CdDataLocFileInfo& a, const CdDataLocFileInfo& b)
+			// The original layout is kept, an edited file must still fit in its sectors
+			if (fileSize > static_cast<u64>(fileInfo.nbSectors) * sectorSize)
 			{
-				return a.size < b.size;
-			})};
+				throw std::runtime_error{ fmt::format("\"{}\" doesn't fit in its {} sectors", filePath, fileInfo.nbSectors) };
+			}
+
+			fileInfo.size = static_cast<u32>(fileSize);
+			buffer.resize(fileInfo.size);
+			File file{ filePath, File::Mode::Read };
+			file.readSparse(0, buffer.data(), buffer.size());
+			cdData000.write(static_cast<u64>(fileInfo.position) * sectorSize, buffer.data(), buffer.size());
+		}
+
+		cdData000.resize(archiveSize);
+
+		const auto nbFiles{ static_cast<u32>(filesInfo.size()) };
+		std::ofstream cdDataLoc{ fmt::format("{}/{}", dest.string(), cdDataLocFilename), std::ofstream::binary };
+		cdDataLoc.write((char*)&nbFiles, sizeof(nbFiles));
+		cdDataLoc.write((char*)filesInfo.data(), filesInfo.size() * sizeof(CdDataLocFileInfo));
+	}
+
+	// Archive being unpacked, its reads are independent and can be done by several threads
+	struct Unpack
+	{
+		std::filesystem::path dest;
+		std::vector<CdDataLocFileInfo> filesInfo;
+		const CDData000::Version* version;
+		File cdData000;
+		std::vector<std::string> genericFilesName;
+		ReadPlanner::Plan readPlan;
+		bool containers;
+		std::atomic<u32> nbContainers;
+		std::atomic<u64> nbHoleBytes;
+		std::unique_ptr<Store> store;
+		bool update;
+		std::atomic<u32> nbUnchanged;
+	};
+
+	static std::unique_ptr<Unpack> prepareUnpack(const std::filesystem::path& src, const std::filesystem::path& dest, const Options& options)
+	{
+		const auto cdData000Path{ Archive::find(src, cdData000Filename) };
+		auto filesInfo{ Archive::readLoc(Archive::find(src, cdDataLocFilename)) };
+		const auto* const version{ options.generic ? nullptr : CDData000::findVersion(filesInfo) };
+
+		auto unpack{ std::make_unique<Unpack>(dest, std::move(filesInfo), version, File{ cdData000Path, File::Mode::Read, options.direct }) };
+		const auto& unpackFilesInfo{ unpack->filesInfo };
 
 		std::filesystem::create_directories(dest);
 
-		fmt::print("Unpacking files...\n");
+		if (version)
+		{
+			fmt::print("{} version, fingerprint {:016X}\n", version->name, CDData000::fingerprint(unpackFilesInfo));
 
-		const auto cdData000FilesPath{ CDData000::filesPath(nbFiles) };
-		std::vector<char> buffer(maxFileSizeElem->size);
-		auto* const bufferPtr{ buffer.data() };
+			// Directories are created up front so reads don't race to create them
+			std::vector<bool> directoriesCreated(CDData000::nbDirectories());
+			CDData000::PathBuffer pathBuffer;
 
-		for (u32 i{}; i < nbFiles; ++i)
+			for (u32 i{}; i < unpackFilesInfo.size(); ++i)
+			{
+				const auto directory{ CDData000::directory(version->filesPath.id(i)) };
+
+				if (!directoriesCreated[directory])
+				{
+					std::filesystem::create_directories(std::filesystem::path{ fmt::format("{}/{}", dest.string(), version->filesPath.path(i, pathBuffer)) }.parent_path());
+					directoriesCreated[directory] = true;
+				}
+			}
+		}
+		else
 		{
-			const std::filesystem::path filePath{ fmt::format("{}/{}", dest.string(), cdData000FilesPath[i]) };
-			const auto fileSize{ filesInfo[i].size };
-			std::filesystem::create_directories(filePath.parent_path());
+			fmt::print("Unknown version, fingerprint {:016X}, files are named by index in \"{}\"\n", CDData000::fingerprint(unpackFilesInfo), unknownDirectory);
+			unpack->genericFilesName = unpackGenericIndex(cdData000Path, unpack->cdData000, unpackFilesInfo, dest);
+		}
 
-			cdData000.seekg(filesInfo[i].position * sectorSize);
-			cdData000.read(bufferPtr, fileSize);
+		// The archive is read by large aligned reads, files are written from slices of them
+		unpack->readPlan = ReadPlanner::plan(unpackFilesInfo, File::directAlignment);
+		unpack->containers = options.containers;
+		unpack->update = options.update;
 
-			std::ofstream file{ filePath, std::ofstream::binary };
-			file.write(bufferPtr, fileSize);
+		if (!options.store.empty())
+		{
+			unpack->store = std::make_unique<Store>(options.store);
 		}
 
-		fmt::print("{} Files unpacked\n", cdData000FilesPath.size());
+		return unpack;
 	}
 
-	void repacker(const std::filesystem::path& src, const std::filesystem::path& dest)
+	// Sizes are compared first so most changed files are never read
+	static bool isUnchanged(const std::filesystem::path& path, std::span<const char> data)
 	{
-		const std::filesystem::path dataPath{ fmt::format("{}/{}", src.string(), dataDirectory) };
+		std::error_code error;
+		const auto size{ std::filesystem::file_size(path, error) };
 
-		if (!std::filesystem::is_directory(dataPath))
+		if (error || size != data.size())
 		{
-			throw std::runtime_error{ fmt::format("Can't find \"{}\" directory in \"{}\"", dataDirectory, src.string()) };
+			return false;
+		}
+		else if (data.empty())
+		{
+			return true;
 		}
 
-		u32 nbFiles{};
+		const MappedFile file{ path };
+		return Diff::equal({ file.data(), file.size() }, data);
+	}
 
-		for (const auto& directoryContent : std::filesystem::recursive_directory_iterator{ dataPath })
+	// Files of a read of the plan, buffer holds at least readPlan.maxReadSize bytes
+	static void unpackRead(Unpack& unpack, const ReadPlanner::Read& read, char* buffer, std::mutex* ioMutex = nullptr)
+	{
+		std::size_t nbRead;
 		{
-			if (std::filesystem::is_regular_file(directoryContent))
+			// Reads of the archive are serialized when threads share it
+			std::unique_lock<std::mutex> lock;
+			if (ioMutex)
 			{
-				++nbFiles;
+				lock = std::unique_lock{ *ioMutex };
+			}
+			nbRead = unpack.cdData000.read(read.position, buffer, read.size);
+		}
+
+		CDData000::PathBuffer pathBuffer;
+
+		for (u32 i{ read.firstEntry }; i < read.firstEntry + read.nbEntries; ++i)
+		{
+			const auto fileIndex{ unpack.readPlan.order[i] };
+			const auto& fileInfo{ unpack.filesInfo[fileIndex] };
+			const auto dataOffset{ static_cast<u64>(fileInfo.position) * sectorSize - read.position };
+
+			if (dataOffset + fileInfo.size > nbRead)
+			{
+				throw std::runtime_error{ fmt::format("\"{}\" is truncated", cdData000Filename) };
+			}
+
+			const std::filesystem::path filePath{ unpack.version ?
+				fmt::format("{}/{}", unpack.dest.string(), unpack.version->filesPath.path(fileIndex, pathBuffer)) :
+				fmt::format("{}/{}/{}", unpack.dest.string(), unknownDirectory, unpack.genericFilesName[fileIndex]) };
+			const std::span<const char> data{ buffer + dataOffset, fileInfo.size };
+
+			// Containers of unknown versions stay whole, their index already rebuilds them
+			if (unpack.version && unpack.containers && Container::isContainer(filePath))
+			{
+				if (const auto layout{ Container::detect(data) })
+				{
+					std::filesystem::remove(filePath);
+					Container::unpack(data, *layout, filePath.string() + Container::directorySuffix);
+					++unpack.nbContainers;
+					continue;
+				}
+			}
+
+			if (unpack.store)
+			{
+				unpack.store->add(data, filePath);
+				continue;
 			}
+
+			if (unpack.update && isUnchanged(filePath, data))
+			{
+				++unpack.nbUnchanged;
+				continue;
+			}
+
+			// Unlinked first, the file may be a hard link to a read only store object of an earlier unpack
+			std::filesystem::remove(filePath);
+
+			// Zero blocks, like the padding of sector aligned data, are left as holes
+			File file{ filePath, File::Mode::Write };
+			unpack.nbHoleBytes += file.writeSparse(0, data.data(), data.size());
+		}
+	}
+
+	static std::string storeStats(const Store& store)
+	{
+		return fmt::format("{} new objects ({:.1f} MiB) in the store, {} files reflinked, {} hard linked, {} copied", store.nbObjectsWritten(),
+			store.objectsWrittenSize() / (1024.0 * 1024.0), store.nbLinks(Store::Link::Reflink), store.nbLinks(Store::Link::Hardlink),
+			store.nbLinks(Store::Link::Copy));
+	}
+
+	void unpacker(const std::filesystem::path& src, const std::filesystem::path& dest, const Options& options)
+	{
+		const auto unpack{ prepareUnpack(src, dest, options) };
+
+		fmt::print("Unpacking files...\n");
+
+		const AlignedBuffer buffer{ unpack->readPlan.maxReadSize };
+
+		for (const auto& read : unpack->readPlan.reads)
+		{
+			unpackRead(*unpack, read, buffer.data());
+		}
+
+		if (unpack->nbContainers)
+		{
+			fmt::print("{} containers unpacked\n", unpack->nbContainers.load());
+		}
+		if (unpack->store)
+		{
+			fmt::print("{}\n", storeStats(*unpack->store));
+		}
+		if (unpack->nbHoleBytes)
+		{
+			fmt::print("{:.1f} MiB of zeros left as holes\n", unpack->nbHoleBytes / (1024.0 * 1024.0));
+		}
+		if (unpack->update)
+		{
+			fmt::print("{} files unchanged\n", unpack->nbUnchanged.load());
+		}
+		fmt::print("{} Files unpacked\n", unpack->filesInfo.size());
+	}
+
+	void repacker(const std::filesystem::path& src, const std::filesystem::path& dest, const Options& options)
+	{
+		const std::filesystem::path dataPath{ fmt::format("{}/{}", src.string(), dataDirectory) };
+		const std::filesystem::path unknownPath{ fmt::format("{}/{}", src.string(), unknownDirectory) };
+
+		if (!std::filesystem::is_directory(dataPath) && std::filesystem::is_regular_file(unknownPath / genericIndexFilename))
+		{
+			progress(options, "Repacking files with the layout of \"{}\"...\n", genericIndexFilename);
+			repackGeneric(unknownPath, dest);
+			progress(options, "Done\n");
+			return;
+		}
+		else if (!std::filesystem::is_directory(dataPath))
+		{
+			throw std::runtime_error{ fmt::format("Can't find \"{}\" directory in \"{}\"", dataDirectory, src.string()) };
 		}
 
-		const auto cdData000FilesPath{ CDData000::filesPath(nbFiles) };
-		u32 maxFileSize{};
+		const auto nbFiles{ countFiles(dataPath) };
+		const auto& cdData000FilesPath{ CDData000::filesPath(nbFiles) };
 		u64 totalFilesSize{};
 
 		std::vector<PathSize> filesPathSize(nbFiles);
+		CDData000::PathBuffer pathBuffer;
 
 		for (u32 i{}; i < nbFiles; ++i)
 		{
-			auto* const file{ &filesPathSize[i] };
-			file->path = fmt::format("{}/{}", src.string(), cdData000FilesPath[i]);
-			file->size = std::filesystem::file_size(file->path);
+			filesPathSize[i].path = fmt::format("{}/{}", src.string(), cdData000FilesPath.path(i, pathBuffer));
+		}
 
-			totalFilesSize += file->size;
-			if (file->size > maxFileSize)
-			{
-				maxFileSize = static_cast<u32>(file->size);
-			}
+		// Files built in memory (containers, edited textures) are written in place of the file on disk
+		std::vector<std::vector<char>> filesData(nbFiles);
+		repackContainers(filesPathSize, filesData);
+
+		if (!options.textures.empty())
+		{
+			const auto nbTextures{ encodeTextures(options.textures, filesPathSize, cdData000FilesPath, filesData) };
+			progress(options, "{} textures encoded from \"{}\"\n", nbTextures, options.textures.string());
+		}
+
+		for (u32 i{}; i < nbFiles; ++i)
+		{
+			auto& [path, size]{ filesPathSize[i] };
+			size = filesData[i].empty() ? std::filesystem::file_size(path) : filesData[i].size();
+			totalFilesSize += size;
 		}
 
 		if (totalFilesSize > std::numeric_limits<u32>::max())
@@ -143,47 +564,1225 @@ namespace JC2Tools
 
 		std::filesystem::create_directories(dest);
 
-		std::ofstream
-			cdData000{ fmt::format("{}/{}", dest.string(), cdData000Filename), std::ofstream::binary },
-			cdDataLoc{ fmt::format("{}/{}", dest.string(), cdDataLocFilename), std::ofstream::binary };
+		progress(options, "Repacking files...\n");
 
-		fmt::print("Repacking files...\n");
+		// Entries are placed in index order unless a layout reorders them
+		std::vector<u32> placement;
 
-		cdDataLoc.write((char*)&nbFiles, sizeof(nbFiles));
+		if (!options.layout.empty())
+		{
+			placement = Layout::placement(options.layout, cdData000FilesPath);
+		}
 
-		u32 sectorPosition{};
-		const auto remainderBuffer{ maxFileSize % sectorSize };
-		std::vector<char> buffer(remainderBuffer ? maxFileSize + sectorSize - remainderBuffer : maxFileSize);
-		auto* const bufferPtr{ buffer.data() };
+		ArchiveWriter archiveWriter{ dest, nbFiles, options.direct, options.update };
 		const std::filesystem::path binExtension{ ".bin" };
 
-		for (const auto& [path, size] : filesPathSize)
+		for (u32 j{}; j < nbFiles; ++j)
+		{
+			const auto i{ placement.empty() ? j : placement[j] };
+			const auto& [path, size]{ filesPathSize[i] };
+			auto* const data{ archiveWriter.add(i, static_cast<u32>(size), path.extension() == binExtension) };
+
+			if (!filesData[i].empty())
+			{
+				std::memcpy(data, filesData[i].data(), size);
+				continue;
+			}
+
+			// Holes of sparse files are zeros that aren't read
+			File file{ path, File::Mode::Read };
+			file.readSparse(0, data, size);
+		}
+
+		archiveWriter.finish();
+
+		if (options.update)
+		{
+			progress(options, "{:.1f} of {:.1f} MiB rewritten\n", archiveWriter.nbBytesWritten() / (1024.0 * 1024.0),
+				std::filesystem::file_size(dest / cdData000Filename) / (1024.0 * 1024.0));
+		}
+		progress(options, "Done\n");
+	}
+
+	void unpacker(const std::filesystem::path& src, File& tar, const Options& options)
+	{
+		const auto cdData000Path{ Archive::find(src, cdData000Filename) };
+		const auto filesInfo{ Archive::readLoc(Archive::find(src, cdDataLocFilename)) };
+		const auto nbFiles{ static_cast<u32>(filesInfo.size()) };
+		const auto& version{ CDData000::version(filesInfo) };
+		const auto& cdData000FilesPath{ version.filesPath };
+
+		File cdData000{ cdData000Path, File::Mode::Read, options.direct };
+
+		fmt::print("{} version, fingerprint {:016X}\n", version.name, CDData000::fingerprint(filesInfo));
+		fmt::print("Unpacking files...\n");
+		const auto mtime{ std::chrono::duration_cast<std::chrono::seconds>(
+			std::chrono::file_clock::to_sys(std::filesystem::last_write_time(cdData000Path)).time_since_epoch()).count() };
+
+		// Headers, directories and padding are gathered in front of each entry to be written at once,
+		// entry data is copied by the kernel unless direct I/O requires an aligned read
+		std::vector<char> pending;
+		std::vector<bool> directoriesEmitted(CDData000::nbDirectories());
+		std::unordered_set<std::string_view> parentDirectories;
+		CDData000::PathBuffer pathBuffer;
+		AlignedBuffer buffer{ 0 };
+		u64 position{};
+
+		const auto pushHeader{ [&](std::string_view path, u64 size, char type)
 		{
-			const CdDataLocFileInfo fileInfo
+			pending.resize(pending.size() + Tar::blockSize);
+			Tar::header(pending.data() + pending.size() - Tar::blockSize, path, size, mtime, type);
+		}};
+
+		for (u32 i{}; i < nbFiles; ++i)
+		{
+			const auto filePath{ cdData000FilesPath.path(i, pathBuffer) };
+			const auto& fileInfo{ filesInfo[i] };
+			const auto directory{ CDData000::directory(cdData000FilesPath.id(i)) };
+
+			if (!directoriesEmitted[directory])
+			{
+				// Parents without files of their own aren't in the path table, they are emitted once too
+				const auto directoryPath{ CDData000::directoryPath(directory) };
+
+				for (auto separator{ directoryPath.find('/') }; separator != std::string_view::npos; separator = directoryPath.find('/', separator + 1))
+				{
+					if (const auto parentPath{ directoryPath.substr(0, separator + 1) }; parentDirectories.insert(parentPath).second)
+					{
+						pushHeader(parentPath, 0, Tar::directoryType);
+					}
+				}
+
+				directoriesEmitted[directory] = true;
+			}
+
+			pushHeader(filePath, fileInfo.size, Tar::regularType);
+
+			const auto dataPosition{ static_cast<u64>(fileInfo.position) * sectorSize };
+
+			if (cdData000.isDirect())
 			{
-				.position = sectorPosition,
-				.size = static_cast<u32>(size),
-				.nbSectors = (static_cast<u32>(size) + sectorSize - 1) >> 0xB,
-				.isABin = static_cast<s32>(path.extension() == binExtension)
-			};
+				const auto readPosition{ alignDown(dataPosition, File::directAlignment) };
+				const auto dataOffset{ static_cast<std::size_t>(dataPosition - readPosition) };
+				const auto readSize{ static_cast<std::size_t>(alignUp(dataOffset + fileInfo.size, File::directAlignment)) };
+
+				if (buffer.size() < readSize)
+				{
+					buffer = AlignedBuffer{ readSize };
+				}
 
-			const auto remainder{ static_cast<u32>(size) % sectorSize };
-			auto fileSizeSector{ static_cast<u32>(size) };
-			if (remainder)
+				if (cdData000.read(readPosition, buffer.data(), readSize) < dataOffset + fileInfo.size)
+				{
+					throw std::runtime_error{ fmt::format("\"{}\" is truncated", cdData000Filename) };
+				}
+
+				pending.insert(pending.end(), buffer.data() + dataOffset, buffer.data() + dataOffset + fileInfo.size);
+				tar.write(position, pending.data(), pending.size());
+				position += pending.size();
+			}
+			else
 			{
-				const auto padding{ sectorSize - remainder };
-				fileSizeSector += padding;
-				std::memset(bufferPtr + size, 0, padding);
+				tar.write(position, pending.data(), pending.size());
+				position += pending.size();
+				tar.copy(position, cdData000, dataPosition, fileInfo.size);
+				position += fileInfo.size;
 			}
 
-			std::ifstream file{ path, std::ifstream::binary };
-			file.read(bufferPtr, size);
-			cdData000.write(bufferPtr, fileSizeSector);
-			cdDataLoc.write((char*)&fileInfo, sizeof(fileInfo));
+			pending.assign(Tar::padding(fileInfo.size), '\0');
+		}
 
-			sectorPosition += fileSizeSector / sectorSize;
+		// End of archive
+		pending.resize(pending.size() + 2 * Tar::blockSize);
+		tar.write(position, pending.data(), pending.size());
+
+		fmt::print("{} Files unpacked\n", nbFiles);
+	}
+
+	void repacker(File& tar, const std::filesystem::path& dest, const Options& options)
+	{
+		std::filesystem::create_directories(dest);
+
+		fmt::print("Repacking files...\n");
+
+		ArchiveWriter archiveWriter{ dest, 0, options.direct };
+		Tar::Reader tarReader{ tar };
+		Tar::Entry entry;
+		std::vector<std::string> filesPath;
+		u64 totalFilesSize{};
+
+		while (tarReader.next(entry))
+		{
+			if (entry.type == Tar::directoryType)
+			{
+				continue;
+			}
+			else if (entry.type != Tar::regularType)
+			{
+				throw std::runtime_error{ fmt::format("\"{}\" isn't a regular file", entry.path) };
+			}
+
+			totalFilesSize += entry.size;
+			if (totalFilesSize > std::numeric_limits<u32>::max())
+			{
+				throw std::runtime_error{ fmt::format("\"{}\" can't be repacked because files exceed the size limit", cdData000Filename) };
+			}
+
+			auto& filePath{ filesPath.emplace_back(entry.path.starts_with("./") ? entry.path.substr(2) : entry.path) };
+			const auto isABin{ std::filesystem::path{ filePath }.extension() == ".bin" };
+			auto* const data{ archiveWriter.add(static_cast<u32>(filesPath.size() - 1), static_cast<u32>(entry.size), isABin) };
+			tarReader.read(data, static_cast<std::size_t>(entry.size));
+		}
+
+		// The game version is only known once the whole stream is read, entries are then moved to their index
+		const auto nbFiles{ static_cast<u32>(filesPath.size()) };
+		const auto& cdData000FilesPath{ CDData000::filesPath(nbFiles) };
+
+		auto& filesInfo{ archiveWriter.filesInfo() };
+		std::vector<CdDataLocFileInfo> sortedFilesInfo(nbFiles);
+		std::vector<bool> found(nbFiles);
+
+		for (u32 i{}; i < nbFiles; ++i)
+		{
+			const auto id{ CDData000::find(filesPath[i]) };
+			const auto index{ id ? cdData000FilesPath.index(*id) : std::nullopt };
+
+			if (!index)
+			{
+				throw std::runtime_error{ fmt::format("\"{}\" isn't a file of \"{}\"", filesPath[i], cdData000Filename) };
+			}
+			else if (found[*index])
+			{
+				throw std::runtime_error{ fmt::format("\"{}\" is duplicated", filesPath[i]) };
+			}
+
+			found[*index] = true;
+			sortedFilesInfo[*index] = filesInfo[i];
 		}
 
+		filesInfo = std::move(sortedFilesInfo);
+		archiveWriter.finish();
+
 		fmt::print("Done\n");
 	}
+
+	void catalog(const std::filesystem::path& src, const std::filesystem::path& dest, const Options& options)
+	{
+		fmt::print("Cataloging files...\n");
+
+		const auto catalog{ Catalog::build(src, options.generic) };
+		const Catalog::View view{ catalog };
+		const auto extension{ dest.extension() };
+
+		if (dest.has_parent_path())
+		{
+			std::filesystem::create_directories(dest.parent_path());
+		}
+
+		if (extension == ".json")
+		{
+			Catalog::exportJson(view, dest);
+		}
+		else if (extension == ".csv")
+		{
+			Catalog::exportCsv(view, dest);
+		}
+		else
+		{
+			std::ofstream file{ dest, std::ofstream::binary };
+			file.write(catalog.data(), catalog.size());
+		}
+
+		fmt::print("{} version, {} files cataloged\n", view.gameVersion(), view.header().nbEntries);
+	}
+
+	void trace(const std::filesystem::path& src, const std::filesystem::path& tracePath, const std::filesystem::path& dest,
+		const Options& options)
+	{
+		const auto filesInfo{ Archive::readLoc(Archive::find(src, cdDataLocFilename)) };
+		const auto& version{ CDData000::version(filesInfo) };
+
+		fmt::print("{} version, fingerprint {:016X}\n", version.name, CDData000::fingerprint(filesInfo));
+		fmt::print("Reading trace...\n");
+
+		const auto report{ Trace::analyze(tracePath, filesInfo, options.baseLba) };
+
+		std::filesystem::create_directories(dest);
+		CDData000::PathBuffer pathBuffer;
+
+		std::ofstream access{ fmt::format("{}/access.csv", dest.string()), std::ofstream::binary };
+		access << "index,path,reads,sectors,firstTouch,firstTimestamp\n";
+
+		std::vector<u32> firstTouchRank(filesInfo.size());
+		for (u32 i{}; i < report.firstTouch.size(); ++i)
+		{
+			firstTouchRank[report.firstTouch[i]] = i + 1;
+		}
+
+		for (u32 i{}; i < filesInfo.size(); ++i)
+		{
+			access << fmt::format("{},{},{},{},{},{}\n", i, version.filesPath.path(i, pathBuffer), report.nbReads[i],
+				report.nbSectorsRead[i], firstTouchRank[i], report.firstTimestamp[i]);
+		}
+
+		std::ofstream layout{ fmt::format("{}/layout.txt", dest.string()), std::ofstream::binary };
+		layout << fmt::format("# First-touch order of {}\n", tracePath.filename().string());
+
+		for (const auto index : report.firstTouch)
+		{
+			layout << version.filesPath.path(index, pathBuffer) << '\n';
+		}
+
+		std::ofstream seeks{ fmt::format("{}/seeks.csv", dest.string()), std::ofstream::binary };
+		seeks << "minDistance,maxDistance,reads\n";
+
+		for (u32 i{}; i < report.seekHistogram.size(); ++i)
+		{
+			const auto minDistance{ i ? u64{ 1 } << (i - 1) : 0 };
+			seeks << fmt::format("{},{},{}\n", minDistance, i ? minDistance * 2 - 1 : 0, report.seekHistogram[i]);
+		}
+
+		fmt::print("{} reads, {} outside of the files, {} files touched\n", report.nbTotalReads, report.nbOutsideReads, report.firstTouch.size());
+	}
+
+	void whois(const std::filesystem::path& src, const std::filesystem::path& offsetsPath, const Options& options)
+	{
+		const auto filesInfo{ Archive::readLoc(Archive::find(src, cdDataLocFilename)) };
+		const auto* const version{ CDData000::findVersion(filesInfo) };
+		const SectorIndex sectorIndex{ filesInfo };
+
+		std::ifstream offsetsFile;
+		if (offsetsPath != "-")
+		{
+			offsetsFile.open(offsetsPath);
+			if (!offsetsFile)
+			{
+				throw std::runtime_error{ fmt::format("Can't open \"{}\"", offsetsPath.string()) };
+			}
+		}
+		auto& offsets{ offsetsPath == "-" ? std::cin : offsetsFile };
+
+		CDData000::PathBuffer pathBuffer;
+		std::string line;
+
+		while (std::getline(offsets, line))
+		{
+			const auto first{ line.find_first_not_of(" \t") };
+			const auto last{ line.find_last_not_of(" \t\r") };
+
+			if (first == std::string::npos || line[first] == '#')
+			{
+				continue;
+			}
+
+			const auto token{ line.substr(first, last - first + 1) };
+			std::size_t parsed{};
+			u64 offset;
+
+			try
+			{
+				offset = std::stoull(token, &parsed, 0);
+			}
+			catch (const std::exception&)
+			{
+				parsed = 0;
+			}
+
+			const auto isSector{ parsed + 1 == token.size() && (token.back() == 's' || token.back() == 'S') };
+
+			if (parsed == 0 || (parsed != token.size() && !isSector))
+			{
+				fmt::print("{} invalid\n", token);
+				continue;
+			}
+
+			// Sectors are disc LBAs when a base LBA is given
+			const auto location{ !isSector ? sectorIndex.locate(offset) :
+				offset >= options.baseLba ? sectorIndex.locate((offset - options.baseLba) * sectorSize) : std::nullopt };
+
+			if (!location)
+			{
+				fmt::print("{} -\n", token);
+				continue;
+			}
+
+			const auto path{ version ? std::string{ version->filesPath.path(location->index, pathBuffer) } :
+				fmt::format("{}/{:05}", unknownDirectory, location->index) };
+
+			fmt::print("{} {} {} +0x{:X}{}\n", token, location->index, path, location->offset,
+				location->offset >= filesInfo[location->index].size ? " (padding)" : "");
+		}
+	}
+
+	void texturesToPng(const std::filesystem::path& src, const std::filesystem::path& dest, const Options& options)
+	{
+		const auto filesInfo{ Archive::readLoc(Archive::find(src, cdDataLocFilename)) };
+		const auto* const version{ options.generic ? nullptr : CDData000::findVersion(filesInfo) };
+		const MappedFile cdData000{ Archive::find(src, cdData000Filename) };
+
+		const auto entryData{ [&](u32 index)
+		{
+			const auto& fileInfo{ filesInfo[index] };
+			const auto position{ static_cast<u64>(fileInfo.position) * sectorSize };
+
+			if (position + fileInfo.size > cdData000.size())
+			{
+				throw std::runtime_error{ fmt::format("\"{}\" is truncated", cdData000Filename) };
+			}
+			return std::span<const char>{ cdData000.data() + position, fileInfo.size };
+		}};
+
+		// Textures are found by their header, directories are created before converting them in parallel
+		std::vector<u32> textures;
+		std::vector<std::filesystem::path> texturesPath;
+		CDData000::PathBuffer pathBuffer;
+
+		for (u32 i{}; i < filesInfo.size(); ++i)
+		{
+			if (Tim2::isTim2(entryData(i)))
+			{
+				textures.push_back(i);
+				auto& path{ texturesPath.emplace_back(version ?
+					fmt::format("{}/{}", dest.string(), version->filesPath.path(i, pathBuffer)) :
+					fmt::format("{}/{}/{:05}.tm2", dest.string(), unknownDirectory, i)) };
+				std::filesystem::create_directories(path.parent_path());
+			}
+		}
+
+		fmt::print("Converting {} textures...\n", textures.size());
+
+		std::atomic<u32> nbPictures{}, nbSkipped{};
+
+		Parallel::forEach(textures.size(), [&](std::size_t i)
+		{
+			const auto data{ entryData(textures[i]) };
+			const auto pictures{ Tim2::pictures(data) };
+
+			for (u32 j{}; j < pictures.size(); ++j)
+			{
+				const auto& header{ pictures[j].header };
+
+				if (!Tim2::isSupported(header))
+				{
+					++nbSkipped;
+					continue;
+				}
+
+				// Pictures after the first one are numbered
+				auto path{ texturesPath[i] };
+				path.replace_extension(j ? fmt::format(".{}.png", j) : ".png");
+				Png::write(path, header.width, header.height, Tim2::decode(data, pictures[j]));
+				++nbPictures;
+			}
+		});
+
+		fmt::print("{} pictures converted, {} of unsupported types skipped\n", nbPictures.load(), nbSkipped.load());
+	}
+
+	void search(const std::filesystem::path& src, const std::string& pattern, const Options& options)
+	{
+		const auto filesInfo{ Archive::readLoc(Archive::find(src, cdDataLocFilename)) };
+		const auto* const version{ options.generic ? nullptr : CDData000::findVersion(filesInfo) };
+		const MappedFile cdData000{ Archive::find(src, cdData000Filename) };
+
+		std::vector<Search::Encoding> encodings;
+		if (options.encoding == "ascii" || options.encoding == "all")
+		{
+			encodings.push_back(Search::Encoding::Ascii);
+		}
+		if (options.encoding == "utf16" || options.encoding == "all")
+		{
+			encodings.push_back(Search::Encoding::Utf16);
+		}
+		if (options.encoding == "sjis" || options.encoding == "all")
+		{
+			encodings.push_back(Search::Encoding::ShiftJis);
+		}
+		if (encodings.empty())
+		{
+			throw std::runtime_error{ fmt::format("Encoding \"{}\" is invalid", options.encoding) };
+		}
+
+		std::vector<std::string> texts{ pattern };
+		texts.insert(texts.end(), options.patterns.begin(), options.patterns.end());
+		std::vector<Search::Pattern> patterns;
+
+		for (const auto& text : texts)
+		{
+			if (options.hex)
+			{
+				patterns.push_back(Search::hex(text));
+				continue;
+			}
+
+			// The same text in several encodings is searched once when the bytes are identical
+			for (const auto encoding : encodings)
+			{
+				try
+				{
+					auto textPattern{ Search::text(text, encoding) };
+					if (std::none_of(patterns.begin(), patterns.end(), [&](const auto& pattern) { return pattern.bytes == textPattern.bytes; }))
+					{
+						patterns.push_back(std::move(textPattern));
+					}
+				}
+				catch (const std::exception& e)
+				{
+					if (encodings.size() == 1)
+					{
+						throw;
+					}
+					fmt::print("{}, skipped\n", e.what());
+				}
+			}
+		}
+
+		const auto entryData{ [&](u32 index)
+		{
+			const auto& fileInfo{ filesInfo[index] };
+			const auto position{ static_cast<u64>(fileInfo.position) * sectorSize };
+
+			if (position + fileInfo.size > cdData000.size())
+			{
+				throw std::runtime_error{ fmt::format("\"{}\" is truncated", cdData000Filename) };
+			}
+			return std::span<const u8>{ reinterpret_cast<const u8*>(cdData000.data()) + position, fileInfo.size };
+		}};
+
+		// Entries are filtered on their path, generic ones are named by index and sniffed type as the unpacker does
+		std::vector<u32> entries;
+		std::vector<std::string> entriesPath;
+		CDData000::PathBuffer pathBuffer;
+
+		for (u32 i{}; i < filesInfo.size(); ++i)
+		{
+			std::string path;
+			if (version)
+			{
+				path = version->filesPath.path(i, pathBuffer);
+			}
+			else
+			{
+				const auto data{ entryData(i) };
+				path = fmt::format("{}/{:05}{}", unknownDirectory, i, Magic::type(reinterpret_cast<const char*>(data.data()),
+					std::min<std::size_t>(data.size(), Magic::headerSize), filesInfo[i].isABin));
+			}
+
+			if (path.starts_with(options.directory) && path.ends_with(options.type))
+			{
+				entries.push_back(i);
+				entriesPath.push_back(std::move(path));
+			}
+		}
+
+		fmt::print("Searching {} patterns in {} files...\n", patterns.size(), entries.size());
+
+		std::vector<std::vector<Search::Match>> matches(entries.size());
+
+		Parallel::forEach(entries.size(), [&](std::size_t i)
+		{
+			matches[i] = Search::find(entryData(entries[i]), patterns);
+		});
+
+		std::size_t nbMatches{}, nbFiles{};
+
+		for (std::size_t i{}; i < entries.size(); ++i)
+		{
+			for (const auto& match : matches[i])
+			{
+				fmt::print("{} {} +0x{:X} {}\n", entries[i], entriesPath[i], match.offset, patterns[match.pattern].label);
+			}
+
+			nbMatches += matches[i].size();
+			nbFiles += !matches[i].empty();
+		}
+
+		fmt::print("{} matches in {} files\n", nbMatches, nbFiles);
+	}
+
+	void versionDiff(const std::filesystem::path& oldSrc, const std::filesystem::path& newSrc, const Options& options)
+	{
+		struct Side
+		{
+			std::vector<CdDataLocFileInfo> filesInfo;
+			const CDData000::Version* version;
+			MappedFile cdData000;
+
+			std::span<const char> data(u32 index) const
+			{
+				const auto& fileInfo{ filesInfo[index] };
+				const auto position{ static_cast<u64>(fileInfo.position) * sectorSize };
+
+				if (position + fileInfo.size > cdData000.size())
+				{
+					throw std::runtime_error{ fmt::format("\"{}\" is truncated", cdData000Filename) };
+				}
+				return { cdData000.data() + position, fileInfo.size };
+			}
+		};
+
+		const auto open{ [&](const std::filesystem::path& src)
+		{
+			auto filesInfo{ Archive::readLoc(Archive::find(src, cdDataLocFilename)) };
+			const auto* const version{ options.generic ? nullptr : CDData000::findVersion(filesInfo) };
+			return Side{ std::move(filesInfo), version, MappedFile{ Archive::find(src, cdData000Filename) } };
+		}};
+
+		const auto oldSide{ open(oldSrc) };
+		const auto newSide{ open(newSrc) };
+
+		fmt::print("Comparing {} files ({}) with {} files ({})...\n", oldSide.filesInfo.size(), oldSide.version ? oldSide.version->name : "Unknown",
+			newSide.filesInfo.size(), newSide.version ? newSide.version->name : "Unknown");
+
+		// Known versions are aligned on the path ids shared by every version, unknown ones by index
+		static constexpr auto none{ std::numeric_limits<u32>::max() };
+		const auto byPath{ oldSide.version && newSide.version };
+		const auto nbSlots{ byPath ? CDData000::nbIds : static_cast<u32>(std::max(oldSide.filesInfo.size(), newSide.filesInfo.size())) };
+		std::vector<std::pair<u32, u32>> pairs(nbSlots, { none, none });
+
+		for (auto* side : { &oldSide, &newSide })
+		{
+			for (u32 i{}; i < side->filesInfo.size(); ++i)
+			{
+				auto& pair{ pairs[byPath ? side->version->filesPath.id(i) : i] };
+				(side == &oldSide ? pair.first : pair.second) = i;
+			}
+		}
+
+		std::erase(pairs, std::pair{ none, none });
+
+		// Both sides are hashed, changed entries are compared for their ranges
+		std::vector<std::vector<Diff::Range>> ranges(pairs.size());
+		std::vector<u8> identical(pairs.size());
+
+		Parallel::forEach(pairs.size(), [&](std::size_t i)
+		{
+			const auto [oldIndex, newIndex]{ pairs[i] };
+
+			if (oldIndex == none || newIndex == none)
+			{
+				return;
+			}
+
+			const auto oldData{ oldSide.data(oldIndex) };
+			const auto newData{ newSide.data(newIndex) };
+
+			if (oldData.size() == newData.size() && Hash::xxh64(oldData.data(), oldData.size()) == Hash::xxh64(newData.data(), newData.size()))
+			{
+				identical[i] = true;
+			}
+			else
+			{
+				ranges[i] = Diff::ranges(oldData, newData);
+			}
+		});
+
+		static constexpr std::size_t maxRangesPrinted{ 8 };
+		u32 nbAdded{}, nbRemoved{}, nbIdentical{}, nbChanged{};
+		CDData000::PathBuffer pathBuffer;
+
+		for (std::size_t i{}; i < pairs.size(); ++i)
+		{
+			const auto [oldIndex, newIndex]{ pairs[i] };
+			const auto& side{ newIndex != none ? newSide : oldSide };
+			const auto index{ newIndex != none ? newIndex : oldIndex };
+			const auto path{ byPath ? std::string{ side.version->filesPath.path(index, pathBuffer) } : fmt::format("{}/{:05}", unknownDirectory, index) };
+
+			if (oldIndex == none)
+			{
+				fmt::print("+ {} {} bytes\n", path, newSide.filesInfo[newIndex].size);
+				++nbAdded;
+			}
+			else if (newIndex == none)
+			{
+				fmt::print("- {} {} bytes\n", path, oldSide.filesInfo[oldIndex].size);
+				++nbRemoved;
+			}
+			else if (identical[i])
+			{
+				++nbIdentical;
+			}
+			else
+			{
+				u64 nbBytes{};
+				std::string summary;
+
+				for (std::size_t j{}; j < ranges[i].size(); ++j)
+				{
+					nbBytes += ranges[i][j].size;
+					if (j < maxRangesPrinted)
+					{
+						summary += fmt::format(" 0x{:X}+{}", ranges[i][j].offset, ranges[i][j].size);
+					}
+				}
+
+				if (ranges[i].size() > maxRangesPrinted)
+				{
+					summary += fmt::format(" ... {} more", ranges[i].size() - maxRangesPrinted);
+				}
+
+				fmt::print("~ {} {} -> {} bytes, {} bytes in {} ranges:{}\n", path, oldSide.filesInfo[oldIndex].size,
+					newSide.filesInfo[newIndex].size, nbBytes, ranges[i].size(), summary);
+				++nbChanged;
+			}
+		}
+
+		fmt::print("{} identical, {} changed, {} added, {} removed\n", nbIdentical, nbChanged, nbAdded, nbRemoved);
+	}
+
+	void batch(const std::filesystem::path& manifestPath, const Options& options)
+	{
+		const auto jobs{ Batch::readManifest(manifestPath) };
+		const auto start{ std::chrono::steady_clock::now() };
+
+		struct JobState
+		{
+			std::unique_ptr<Unpack> unpack;
+			std::mutex ioMutex;
+			std::atomic<u32> nbRemainingTasks;
+			std::atomic<u64> nbBytes;
+		};
+
+		// Tasks of every archive go through the same threads, a repack is one task, an unpack one task per read
+		struct Task
+		{
+			u32 job;
+			const ReadPlanner::Read* read;
+		};
+
+		std::vector<JobState> states(jobs.size());
+		std::vector<Task> tasks;
+
+		for (u32 i{}; i < jobs.size(); ++i)
+		{
+			const auto& job{ jobs[i] };
+
+			if (job.operation == Batch::Operation::Repack)
+			{
+				tasks.push_back({ i, nullptr });
+				states[i].nbRemainingTasks = 1;
+			}
+		}
+
+		for (u32 i{}; i < jobs.size(); ++i)
+		{
+			const auto& job{ jobs[i] };
+
+			if (job.operation == Batch::Operation::Unpack)
+			{
+				fmt::print("[{}/{}] \"{}\": ", i + 1, jobs.size(), job.src.string());
+				auto& state{ states[i] };
+				state.unpack = prepareUnpack(job.src, job.dest, options);
+
+				for (const auto& read : state.unpack->readPlan.reads)
+				{
+					tasks.push_back({ i, &read });
+				}
+				state.nbRemainingTasks = static_cast<u32>(state.unpack->readPlan.reads.size());
+			}
+		}
+
+		// Repacks run on a batch thread each, their own parallel loops stay on it (see Parallel::forEach)
+		auto jobOptions{ options };
+		jobOptions.quiet = true;
+
+		const auto nbIo{ options.ioLimit ? options.ioLimit : static_cast<u32>(Parallel::nbThreads()) };
+		fmt::print("Running {} jobs as {} tasks on {} threads, {} I/O at a time...\n", jobs.size(), tasks.size(), Parallel::nbThreads(), nbIo);
+
+		std::counting_semaphore<> ioSlots{ nbIo };
+		std::mutex printMutex;
+		std::atomic<u32> nbDone{};
+
+		const auto finish{ [&](u32 index)
+		{
+			const auto& job{ jobs[index] };
+			const auto& state{ states[index] };
+			const auto elapsed{ std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count() };
+			const std::lock_guard lock{ printMutex };
+
+			fmt::print("[{}/{}] {} \"{}\" to \"{}\": {:.1f} MiB", ++nbDone, jobs.size(), job.operation == Batch::Operation::Unpack ? "Unpacked" : "Repacked",
+				job.src.string(), job.dest.string(), state.nbBytes / (1024.0 * 1024.0));
+			if (state.unpack)
+			{
+				fmt::print(", {} files, {} containers", state.unpack->filesInfo.size(), state.unpack->nbContainers.load());
+				if (state.unpack->store)
+				{
+					fmt::print(", {}", storeStats(*state.unpack->store));
+				}
+			}
+			fmt::print(", done at {:.2f}s\n", elapsed);
+		}};
+
+		Parallel::forEach(tasks.size(), [&](std::size_t i)
+		{
+			const auto& task{ tasks[i] };
+			const auto& job{ jobs[task.job] };
+			auto& state{ states[task.job] };
+
+			ioSlots.acquire();
+
+			try
+			{
+				if (task.read)
+				{
+					const AlignedBuffer buffer{ task.read->size };
+					unpackRead(*state.unpack, *task.read, buffer.data(), &state.ioMutex);
+					state.nbBytes += task.read->size;
+				}
+				else
+				{
+					repacker(job.src, job.dest, jobOptions);
+					state.nbBytes = std::filesystem::file_size(job.dest / cdData000Filename);
+				}
+			}
+			catch (const std::exception& e)
+			{
+				ioSlots.release();
+				throw std::runtime_error{ fmt::format("\"{}\": {}", job.src.string(), e.what()) };
+			}
+
+			ioSlots.release();
+
+			if (--state.nbRemainingTasks == 0)
+			{
+				finish(task.job);
+			}
+		});
+
+		fmt::print("{} jobs done in {:.2f}s\n", jobs.size(), std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+	}
+
+	void watch(const std::filesystem::path& src, const std::filesystem::path& dest, const Options& options)
+	{
+		const std::filesystem::path dataPath{ fmt::format("{}/{}", src.string(), dataDirectory) };
+
+		if (!std::filesystem::is_directory(dataPath))
+		{
+			throw std::runtime_error{ fmt::format("Can't find \"{}\" directory in \"{}\"", dataDirectory, src.string()) };
+		}
+
+		// The archive starts from a full repack, the watcher is set up first so no save is missed
+		Watcher watcher{ dataPath };
+		repacker(src, dest, options);
+
+		const auto cdDataLocPath{ Archive::find(dest, cdDataLocFilename) };
+		auto filesInfo{ Archive::readLoc(cdDataLocPath) };
+		const auto& filesPath{ CDData000::filesPath(static_cast<u32>(filesInfo.size())) };
+		File cdData000{ Archive::find(dest, cdData000Filename), File::Mode::Update };
+		File cdDataLoc{ cdDataLocPath, File::Mode::Update };
+
+		// A Merkle tree next to the archive was brought up to date by the repack, it follows the entries written
+		const auto merklePath{ Archive::find(dest, cdData000Filename).parent_path() / Merkle::filename };
+		std::optional<Merkle::Tree> merkle;
+
+		if (std::filesystem::is_regular_file(merklePath))
+		{
+			merkle.emplace(merklePath);
+		}
+
+		// Content hash of every entry as last written and first free sector at the end of the archive
+		std::vector<u64> filesHash(filesInfo.size());
+		u32 endSector{};
+		{
+			const MappedFile archive{ Archive::find(dest, cdData000Filename) };
+
+			Parallel::forEach(filesInfo.size(), [&](std::size_t i)
+			{
+				filesHash[i] = Hash::xxh64(archive.data() + static_cast<u64>(filesInfo[i].position) * sectorSize, filesInfo[i].size);
+			});
+		}
+
+		for (const auto& fileInfo : filesInfo)
+		{
+			endSector = std::max(endSector, fileInfo.position + fileInfo.nbSectors);
+		}
+
+		fmt::print("Watching \"{}\", Ctrl+C to stop\n", dataPath.string());
+		std::fflush(stdout);
+
+		const auto srcPath{ std::filesystem::absolute(src).lexically_normal() };
+		std::vector<char> sector(sectorSize);
+
+		while (true)
+		{
+			const auto changedPaths{ watcher.wait(std::chrono::milliseconds{ options.debounce }) };
+			const auto start{ std::chrono::steady_clock::now() };
+			std::vector<std::filesystem::path> entriesPath;
+
+			// Files of an unpacked container stand for the container
+			for (const auto& changedPath : changedPaths)
+			{
+				auto path{ changedPath };
+
+				for (auto parent{ changedPath.parent_path() }; parent.has_relative_path() && parent != dataPath; parent = parent.parent_path())
+				{
+					if (parent.extension() == Container::directorySuffix)
+					{
+						path = parent;
+						path.replace_extension();
+						break;
+					}
+				}
+
+				if (entriesPath.empty() || entriesPath.back() != path)
+				{
+					entriesPath.push_back(std::move(path));
+				}
+			}
+
+			u32 nbUpdated{};
+
+			for (const auto& path : entriesPath)
+			{
+				const auto relativePath{ std::filesystem::absolute(path).lexically_normal().lexically_relative(srcPath).generic_string() };
+				const auto id{ CDData000::find(relativePath) };
+				const auto index{ id ? filesPath.index(*id) : std::nullopt };
+
+				if (!index || *index >= filesInfo.size())
+				{
+					fmt::print("\"{}\" is not a file of the archive, skipped\n", relativePath);
+					continue;
+				}
+
+				const std::filesystem::path containerPath{ path.string() + Container::directorySuffix };
+				std::vector<char> data;
+
+				try
+				{
+					if (Container::isContainer(path) && !std::filesystem::exists(path) && std::filesystem::is_directory(containerPath))
+					{
+						data = Container::repack(containerPath);
+					}
+					else
+					{
+						File file{ path, File::Mode::Read };
+						data.resize(static_cast<std::size_t>(file.size()));
+						file.readSparse(0, data.data(), data.size());
+					}
+				}
+				catch (const std::exception& e)
+				{
+					// Files removed or replaced again since the event
+					fmt::print("\"{}\" can't be read, skipped: {}\n", relativePath, e.what());
+					continue;
+				}
+
+				const auto hash{ Hash::xxh64(data.data(), data.size()) };
+				auto& fileInfo{ filesInfo[*index] };
+
+				if (data.size() == fileInfo.size && hash == filesHash[*index])
+				{
+					continue;
+				}
+
+				if (data.size() > std::numeric_limits<u32>::max() - static_cast<u64>(endSector) * sectorSize)
+				{
+					fmt::print("\"{}\" exceeds the size limit, skipped\n", relativePath);
+					continue;
+				}
+
+				// Entries that still fit in their sectors are rewritten in place, bigger ones move to the end
+				const auto nbSectors{ static_cast<u32>((data.size() + sectorSize - 1) / sectorSize) };
+				const auto inPlace{ nbSectors <= fileInfo.nbSectors };
+
+				if (!inPlace)
+				{
+					fileInfo.position = endSector;
+					endSector += nbSectors;
+				}
+
+				const auto position{ static_cast<u64>(fileInfo.position) * sectorSize };
+				const auto padding{ static_cast<std::size_t>(nbSectors) * sectorSize - data.size() };
+				const File::Segment segments[]{ { data.data(), data.size() }, { sector.data(), padding } };
+				cdData000.write(position, segments);
+
+				if (merkle)
+				{
+					merkle->touch(position, static_cast<u64>(nbSectors) * sectorSize);
+				}
+
+				fileInfo.size = static_cast<u32>(data.size());
+				fileInfo.nbSectors = nbSectors;
+				cdDataLoc.write(locHeaderSize + static_cast<u64>(*index) * sizeof(CdDataLocFileInfo), &fileInfo, sizeof(fileInfo));
+				filesHash[*index] = hash;
+
+				fmt::print("{} {}, {} bytes\n", inPlace ? "Updated" : "Moved", relativePath, data.size());
+				++nbUpdated;
+			}
+
+			if (nbUpdated && merkle)
+			{
+				merkle->update(Archive::find(dest, cdData000Filename));
+				merkle->save(merklePath);
+			}
+
+			if (nbUpdated)
+			{
+				fmt::print("{} files applied in {:.1f} ms\n", nbUpdated,
+					std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count());
+			}
+
+			// Reports stay in order when the output is piped to a log
+			std::fflush(stdout);
+		}
+	}
+
+	void daemon(const std::filesystem::path& src, const std::filesystem::path& socketPath, const Options& options)
+	{
+		fmt::print("Mapping and hashing the archive...\n");
+		Daemon daemon{ src, options.generic };
+		daemon.serve(socketPath);
+	}
+
+	void overlayRepacker(const std::filesystem::path& base, const std::filesystem::path& dest, const Options& options)
+	{
+		const auto baseLocPath{ Archive::find(base, cdDataLocFilename) };
+		const auto filesInfo{ Archive::readLoc(baseLocPath) };
+		const auto* const version{ CDData000::findVersion(filesInfo) };
+
+		if (!version)
+		{
+			throw std::runtime_error{ fmt::format("Overlays need a known game version, \"{}\" is unknown", base.string()) };
+		}
+
+		std::filesystem::create_directories(dest);
+
+		if (std::filesystem::equivalent(base, dest))
+		{
+			throw std::runtime_error{ fmt::format("\"{}\" can't be repacked over itself", base.string()) };
+		}
+
+		// Later overlays win, files inside an unpacked container stand for the container
+		std::vector<std::filesystem::path> replacements(filesInfo.size());
+		std::vector<u32> replacementOverlays(filesInfo.size());
+		u32 nbConflicts{};
+
+		for (u32 overlay{}; overlay < options.overlays.size(); ++overlay)
+		{
+			const auto& overlayPath{ options.overlays[overlay] };
+			const std::filesystem::path dataPath{ fmt::format("{}/{}", overlayPath.string(), dataDirectory) };
+
+			if (!std::filesystem::is_directory(dataPath))
+			{
+				throw std::runtime_error{ fmt::format("Can't find \"{}\" directory in \"{}\"", dataDirectory, overlayPath.string()) };
+			}
+
+			for (auto it{ std::filesystem::recursive_directory_iterator{ dataPath } }; it != std::filesystem::recursive_directory_iterator{}; ++it)
+			{
+				auto path{ it->path() };
+
+				if (it->is_directory() && std::filesystem::is_regular_file(path / Container::indexFilename))
+				{
+					it.disable_recursion_pending();
+					path.replace_extension();
+				}
+				else if (!it->is_regular_file())
+				{
+					continue;
+				}
+
+				const auto relativePath{ path.lexically_relative(overlayPath).generic_string() };
+				const auto id{ CDData000::find(relativePath) };
+				const auto index{ id ? version->filesPath.index(*id) : std::nullopt };
+
+				if (!index || *index >= filesInfo.size())
+				{
+					fmt::print("\"{}\" of \"{}\" is not a file of the archive, ignored\n", relativePath, overlayPath.string());
+					continue;
+				}
+
+				if (!replacements[*index].empty())
+				{
+					fmt::print("Conflict: {} of \"{}\" replaces the one of \"{}\"\n", relativePath, overlayPath.string(),
+						options.overlays[replacementOverlays[*index]].string());
+					++nbConflicts;
+				}
+
+				replacements[*index] = it->is_directory() ? it->path() : path;
+				replacementOverlays[*index] = overlay;
+			}
+		}
+
+		File baseCdData000{ Archive::find(base, cdData000Filename), File::Mode::Read };
+		File cdData000{ fmt::format("{}/{}", dest.string(), cdData000Filename), File::Mode::Write };
+		const auto baseSize{ baseCdData000.size() };
+
+		// Entries keep the order of the base, untouched ones are copied by the kernel (copy_file_range) in runs
+		std::vector<u32> order(filesInfo.size());
+		for (u32 i{}; i < order.size(); ++i)
+		{
+			order[i] = i;
+		}
+		std::stable_sort(order.begin(), order.end(), [&](u32 lhs, u32 rhs) { return filesInfo[lhs].position < filesInfo[rhs].position; });
+
+		auto newFilesInfo{ filesInfo };
+		u64 runBasePosition{}, runPosition{}, runSize{}, copiedSize{};
+		u32 sectorPosition{}, nbReplaced{};
+		const std::vector<char> padding(sectorSize);
+
+		const auto flushRun{ [&]()
+		{
+			if (runSize)
+			{
+				// The last entry of the base may not be padded to a full sector, what is past its end
+				// stays a hole of the new archive, which is resized over it, so it reads as zeros
+				const auto size{ std::min(runSize, baseSize - std::min(runBasePosition, baseSize)) };
+				cdData000.copy(runPosition, baseCdData000, runBasePosition, size);
+				copiedSize += size;
+				runSize = 0;
+			}
+		}};
+
+		for (const auto index : order)
+		{
+			const auto& fileInfo{ filesInfo[index] };
+			auto& newFileInfo{ newFilesInfo[index] };
+			const auto position{ static_cast<u64>(sectorPosition) * sectorSize };
+
+			if (replacements[index].empty())
+			{
+				const auto basePosition{ static_cast<u64>(fileInfo.position) * sectorSize };
+				const auto size{ static_cast<u64>(fileInfo.nbSectors) * sectorSize };
+
+				if (runSize && runBasePosition + runSize != basePosition)
+				{
+					flushRun();
+				}
+				if (!runSize)
+				{
+					runBasePosition = basePosition;
+					runPosition = position;
+				}
+
+				runSize += size;
+				newFileInfo.position = sectorPosition;
+				sectorPosition += fileInfo.nbSectors;
+				continue;
+			}
+
+			flushRun();
+
+			const auto& path{ replacements[index] };
+			std::vector<char> data;
+
+			if (std::filesystem::is_directory(path))
+			{
+				data = Container::repack(path);
+			}
+			else
+			{
+				File file{ path, File::Mode::Read };
+				data.resize(static_cast<std::size_t>(file.size()));
+				file.readSparse(0, data.data(), data.size());
+			}
+
+			const auto nbSectors{ static_cast<u32>((data.size() + sectorSize - 1) / sectorSize) };
+			const File::Segment segments[]{ { data.data(), data.size() }, { padding.data(), nbSectors * sectorSize - data.size() } };
+			cdData000.write(position, segments);
+
+			newFileInfo = { sectorPosition, static_cast<u32>(data.size()), nbSectors, fileInfo.isABin };
+			sectorPosition += nbSectors;
+			++nbReplaced;
+
+			if (static_cast<u64>(sectorPosition) * sectorSize > std::numeric_limits<u32>::max())
+			{
+				throw std::runtime_error{ fmt::format("\"{}\" can't be repacked because files exceed the size limit", cdData000Filename) };
+			}
+		}
+
+		flushRun();
+		cdData000.resize(static_cast<u64>(sectorPosition) * sectorSize);
+
+		const auto nbFiles{ static_cast<u32>(newFilesInfo.size()) };
+		std::ofstream cdDataLoc{ fmt::format("{}/{}", dest.string(), cdDataLocFilename), std::ofstream::binary };
+		cdDataLoc.write((char*)&nbFiles, sizeof(nbFiles));
+		cdDataLoc.write((char*)newFilesInfo.data(), newFilesInfo.size() * sizeof(CdDataLocFileInfo));
+
+		fmt::print("{} files replaced from {} overlays, {} conflicts, {} files ({:.1f} MiB) copied from the base\n", nbReplaced,
+			options.overlays.size(), nbConflicts, filesInfo.size() - nbReplaced, copiedSize / (1024.0 * 1024.0));
+	}
+
+	void verify(const std::filesystem::path& src, const std::string& reference, const Options& options)
+	{
+		const auto cdData000Path{ Archive::find(src, cdData000Filename) };
+		const auto merklePath{ cdData000Path.parent_path() / Merkle::filename };
+		const auto start{ std::chrono::steady_clock::now() };
+
+		// The tree is trusted while CDDATA.000 keeps the size and modification time it was hashed at
+		std::optional<Merkle::Tree> tree;
+
+		if (std::filesystem::is_regular_file(merklePath))
+		{
+			tree.emplace(merklePath);
+
+			if (!tree->isCurrent(cdData000Path))
+			{
+				fmt::print("\"{}\" is stale\n", Merkle::filename);
+				tree.reset();
+			}
+		}
+
+		if (!tree)
+		{
+			tree = Merkle::Tree::build(cdData000Path);
+			tree->save(merklePath);
+			fmt::print("{} groups hashed in {:.2f}s\n", tree->nbGroups(), std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+		}
+
+		fmt::print("Root {:02x}\n", fmt::join(tree->root(), ""));
+
+		if (reference == "-")
+		{
+			return;
+		}
+
+		// Known-good build given by its tree (CDDATA.MKL or its directory) or its root
+		std::filesystem::path referencePath{ reference };
+
+		if (std::filesystem::is_directory(referencePath))
+		{
+			referencePath /= Merkle::filename;
+		}
+
+		if (!std::filesystem::is_regular_file(referencePath))
+		{
+			auto root{ reference };
+			std::transform(root.begin(), root.end(), root.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+			if (root.size() != 2 * sizeof(Hash::Sha256) || root.find_first_not_of("0123456789abcdef") != std::string::npos)
+			{
+				throw std::runtime_error{ fmt::format("\"{}\" is neither a Merkle tree nor a root hash", reference) };
+			}
+
+			fmt::print("{} the known-good build\n", root == fmt::format("{:02x}", fmt::join(tree->root(), "")) ? "Matches" : "Differs from");
+			return;
+		}
+
+		// Only the subtrees whose hashes differ are walked down
+		const auto groups{ tree->diff(Merkle::Tree{ referencePath }) };
+
+		if (groups.empty())
+		{
+			fmt::print("Matches the known-good build\n");
+			return;
+		}
+
+		fmt::print("{} groups ({:.1f} MiB) differ from the known-good build\n", groups.size(), groups.size() * Merkle::groupSize / (1024.0 * 1024.0));
+
+		// Files with sectors in a differing group
+		const auto filesInfo{ Archive::readLoc(Archive::find(src, cdDataLocFilename)) };
+		const auto* const version{ options.generic ? nullptr : CDData000::findVersion(filesInfo) };
+		CDData000::PathBuffer pathBuffer;
+
+		for (u32 i{}; i < filesInfo.size(); ++i)
+		{
+			const auto& fileInfo{ filesInfo[i] };
+			const auto lastGroup{ (fileInfo.position + std::max(fileInfo.nbSectors, 1u) - 1) / Merkle::groupSectors };
+			const auto group{ std::lower_bound(groups.begin(), groups.end(), fileInfo.position / Merkle::groupSectors) };
+
+			if (group != groups.end() && *group <= lastGroup)
+			{
+				fmt::print("~ {}\n", version ? std::string{ version->filesPath.path(i, pathBuffer) } : fmt::format("{}/{:05}", unknownDirectory, i));
+			}
+		}
+	}
 }
\ No newline at end of file
@@ -1,9 +1,91 @@
 #pragma once
 
+#include "Types.hpp"
+
 #include <filesystem>
+#include <string>
+#include <vector>
+
+class File;
 
 namespace JC2Tools
 {
-	void unpacker(const std::filesystem::path& src, const std::filesystem::path& dest);
-	void repacker(const std::filesystem::path& src, const std::filesystem::path& dest);
+	struct Options
+	{
+		bool direct{};
+		// Names entries by index and sniffed type as done for unknown versions
+		bool generic{};
+		// Placement of the repacked entries, see Layout::placement
+		std::filesystem::path layout;
+		// Disc LBA of the first sector of CDDATA.000 in traces
+		u32 baseLba{};
+		// Edited PNGs of TIM2 textures re-encoded by the repacker
+		std::filesystem::path textures;
+		// Unpacks the members of .bin and .hbin containers, the repacker rebuilds them
+		bool containers{};
+		// Search patterns after the first one, hex byte strings instead of text, text encoding (ascii, utf16, sjis or all)
+		std::vector<std::string> patterns;
+		bool hex{};
+		std::string encoding{ "ascii" };
+		// Search filters on the entry type (".evs") and the start of the path ("data/esdata/")
+		std::string type;
+		std::string directory;
+		// CDDATA.000 reads and writes in flight across a batch, 0 for one per thread
+		u32 ioLimit{};
+		// Content addressed store the unpacked files are linked to, see Store
+		std::filesystem::path store;
+		// Quiet time in milliseconds after a save before watched files are applied
+		u32 debounce{ 50 };
+		// Directories of replaced files laid out as unpacked ("data/..."), for the overlay repacker
+		std::vector<std::filesystem::path> overlays;
+		// Existing unpacked files and archives are compared, only what differs is written
+		bool update{};
+		// Progress lines of the repacker left out, set by the batch which reports every job once done
+		bool quiet{};
+	};
+
+	void unpacker(const std::filesystem::path& src, const std::filesystem::path& dest, const Options& options = {});
+	void repacker(const std::filesystem::path& src, const std::filesystem::path& dest, const Options& options = {});
+
+	// Tar streams in path table order, repacked entries are placed in stream order
+	void unpacker(const std::filesystem::path& src, File& tar, const Options& options = {});
+	void repacker(File& tar, const std::filesystem::path& dest, const Options& options = {});
+
+	// Binary catalog, exported as text when dest ends with .json or .csv
+	void catalog(const std::filesystem::path& src, const std::filesystem::path& dest, const Options& options = {});
+
+	// Per-file access counts, first-touch order (usable as a layout) and seek histogram of an emulator sector-read trace
+	void trace(const std::filesystem::path& src, const std::filesystem::path& tracePath, const std::filesystem::path& dest,
+		const Options& options = {});
+
+	// Entry, path and offset in the entry of byte offsets of CDDATA.000, one per line, sectors end with s
+	void whois(const std::filesystem::path& src, const std::filesystem::path& offsetsPath, const Options& options = {});
+
+	// TIM2 textures of CDDATA.000 converted to PNG with the paths of the unpacker
+	void texturesToPng(const std::filesystem::path& src, const std::filesystem::path& dest, const Options& options = {});
+
+	// Path and offset in the entry of every match of the patterns in CDDATA.000, without unpacking
+	void search(const std::filesystem::path& src, const std::string& pattern, const Options& options = {});
+
+	// Entries added, removed, identical and changed between two archives aligned by path, with the byte ranges of changed ones
+	void versionDiff(const std::filesystem::path& oldSrc, const std::filesystem::path& newSrc, const Options& options = {});
+
+	// Unpacks and repacks of a manifest (see Batch::readManifest) sharing the same threads, options apply to every job,
+	// jobs run at the same time, a repack can't use what an unpack of the same batch writes
+	void batch(const std::filesystem::path& manifestPath, const Options& options = {});
+
+	// Full repack, then files saved in the data directory of src are applied to dest as they change (Linux, inotify),
+	// in place when they fit in their sectors, otherwise moved to the end of CDDATA.000
+	void watch(const std::filesystem::path& src, const std::filesystem::path& dest, const Options& options = {});
+
+	// Serves list, stat, read and search requests of the archive on a Unix socket until killed, see Daemon
+	void daemon(const std::filesystem::path& src, const std::filesystem::path& socketPath, const Options& options = {});
+
+	// Base archive with the files of options.overlays directories (in order, later ones win) replacing its own,
+	// untouched entries are copied from the base without going through memory
+	void overlayRepacker(const std::filesystem::path& base, const std::filesystem::path& dest, const Options& options);
+
+	// Merkle tree of CDDATA.000 (see Merkle) brought up to date then compared with the tree or the root of a known-good build,
+	// "-" only prints the root
+	void verify(const std::filesystem::path& src, const std::string& reference, const Options& options = {});
 }
\ No newline at end of file
@@ -0,0 +1,138 @@
+#include "Layout.hpp"
+
+#include "fmt/format.h"
+
+#include <fstream>
+#include <stdexcept>
+#include <string>
+
+namespace Layout
+{
+	bool match(std::string_view pattern, std::string_view path)
+	{
+		std::size_t patternIndex{}, pathIndex{};
+		auto starIndex{ std::string_view::npos };
+		std::size_t starPathIndex{};
+
+		while (pathIndex < path.size())
+		{
+			if (patternIndex < pattern.size() && (pattern[patternIndex] == '?' || pattern[patternIndex] == path[pathIndex]))
+			{
+				++patternIndex;
+				++pathIndex;
+			}
+			else if (patternIndex < pattern.size() && pattern[patternIndex] == '*')
+			{
+				starIndex = patternIndex++;
+				starPathIndex = pathIndex;
+			}
+			else if (starIndex != std::string_view::npos)
+			{
+				// Backtracks to the last star, which absorbs one more character
+				patternIndex = starIndex + 1;
+				pathIndex = ++starPathIndex;
+			}
+			else
+			{
+				return false;
+			}
+		}
+
+		while (patternIndex < pattern.size() && pattern[patternIndex] == '*')
+		{
+			++patternIndex;
+		}
+
+		return patternIndex == pattern.size();
+	}
+
+	std::vector<u32> placement(const std::filesystem::path& layoutPath, const CDData000::PathView& filesPath)
+	{
+		std::ifstream layout{ layoutPath };
+
+		if (!layout)
+		{
+			throw std::runtime_error{ fmt::format("Can't open \"{}\"", layoutPath.string()) };
+		}
+
+		const auto nbFiles{ static_cast<u32>(filesPath.size()) };
+		std::vector<u32> placement;
+		placement.reserve(nbFiles);
+		std::vector<bool> placed(nbFiles);
+		u32 nbUnmatched{};
+		CDData000::PathBuffer pathBuffer;
+
+		const auto place{ [&](u32 index)
+		{
+			if (!placed[index])
+			{
+				placed[index] = true;
+				placement.push_back(index);
+			}
+		}};
+
+		std::string line;
+
+		while (std::getline(layout, line))
+		{
+			std::string_view path{ line };
+
+			while (!path.empty() && (path.back() == '\r' || path.back() == ' ' || path.back() == '\t'))
+			{
+				path.remove_suffix(1);
+			}
+
+			if (path.empty() || path.front() == '#')
+			{
+				continue;
+			}
+			else if (path.find_first_of("*?") == std::string_view::npos)
+			{
+				const auto id{ CDData000::find(path) };
+				const auto index{ id ? filesPath.index(*id) : std::nullopt };
+
+				if (index && *index < nbFiles)
+				{
+					place(*index);
+				}
+				else
+				{
+					++nbUnmatched;
+				}
+			}
+			else
+			{
+				// Groups keep the index order of their entries
+				bool matched{};
+
+				for (u32 i{}; i < nbFiles; ++i)
+				{
+					if (match(path, filesPath.path(i, pathBuffer)))
+					{
+						place(i);
+						matched = true;
+					}
+				}
+
+				if (!matched)
+				{
+					++nbUnmatched;
+				}
+			}
+		}
+
+		if (nbUnmatched)
+		{
+			fmt::print("{} lines of \"{}\" don't match any file of this version\n", nbUnmatched, layoutPath.string());
+		}
+
+		fmt::print("{} files placed by \"{}\"\n", placement.size(), layoutPath.filename().string());
+
+		for (u32 i{}; i < nbFiles; ++i)
+		{
+			place(i);
+		}
+
+		return placement;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "CDData000.hpp"
+#include "Types.hpp"
+
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+// Physical placement of the entries in CDDATA.000, LOC indices are never changed
+namespace Layout
+{
+	// * matches any characters, ? a single one
+	bool match(std::string_view pattern, std::string_view path);
+
+	// Entries in placement order, a layout file lists paths in access order or patterns of entries to group,
+	// one per line (# for comments), entries it doesn't mention follow in index order
+	std::vector<u32> placement(const std::filesystem::path& layoutPath, const CDData000::PathView& filesPath);
+}
\ No newline at end of file
@@ -0,0 +1,116 @@
+#include "Magic.hpp"
+
+#include "File.hpp"
+#include "Parallel.hpp"
+
+#include <array>
+#include <cstring>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace Magic
+{
+	struct Signature
+	{
+		std::array<u8, headerSize> bytes;
+		std::array<u8, headerSize> mask;
+		std::string_view extension;
+	};
+
+	static consteval Signature signature(std::string_view magic, std::string_view extension, std::size_t offset = 0)
+	{
+		Signature signature{ .bytes = {}, .mask = {}, .extension = extension };
+
+		for (std::size_t i{}; i < magic.size(); ++i)
+		{
+			signature.bytes[offset + i] = static_cast<u8>(magic[i]);
+			signature.mask[offset + i] = 0xFF;
+		}
+
+		return signature;
+	}
+
+	using namespace std::string_view_literals;
+
+	static constexpr std::array signatures
+	{
+		signature("TIM2", ".tm2"),
+		signature("ipum", ".ipu"),
+		signature("VAGp", ".vag"),
+		signature("IECSsreV", ".hd"),
+		signature("pBAV", ".vab"),
+		signature("SShd", ".ads"),
+		signature("\0\0\1\xBA"sv, ".pss"),
+		signature("RIFF", ".wav"),
+		signature("MThd", ".mid"),
+		signature("\x89PNG", ".png")
+	};
+
+	std::string_view extension(const char* header, std::size_t size)
+	{
+		alignas(16) std::array<u8, headerSize> data{};
+		std::memcpy(data.data(), header, std::min(size, headerSize));
+
+#ifdef __SSE2__
+		const auto dataVector{ _mm_load_si128(reinterpret_cast<const __m128i*>(data.data())) };
+
+		for (const auto& signature : signatures)
+		{
+			const auto masked{ _mm_and_si128(dataVector, _mm_loadu_si128(reinterpret_cast<const __m128i*>(signature.mask.data()))) };
+			const auto equal{ _mm_cmpeq_epi8(masked, _mm_loadu_si128(reinterpret_cast<const __m128i*>(signature.bytes.data()))) };
+
+			if (_mm_movemask_epi8(equal) == 0xFFFF)
+			{
+				return signature.extension;
+			}
+		}
+#else
+		for (const auto& signature : signatures)
+		{
+			std::size_t i{};
+			while (i < headerSize && (data[i] & signature.mask[i]) == signature.bytes[i])
+			{
+				++i;
+			}
+
+			if (i == headerSize)
+			{
+				return signature.extension;
+			}
+		}
+#endif
+		return {};
+	}
+
+	std::string_view type(const char* data, std::size_t size, bool isABin)
+	{
+		if (isABin)
+		{
+			return ".bin";
+		}
+
+		const auto extension{ Magic::extension(data, size) };
+		return extension.empty() ? ".dat" : extension;
+	}
+
+	std::vector<std::string_view> extensions(const std::filesystem::path& cdData000Path,
+		std::span<const Archive::CdDataLocFileInfo> filesInfo)
+	{
+		std::vector<std::string_view> extensions(filesInfo.size());
+		File cdData000{ cdData000Path, File::Mode::Read };
+
+		Parallel::forEach(filesInfo.size(), [&](std::size_t i)
+		{
+			const auto& fileInfo{ filesInfo[i] };
+			std::array<char, headerSize> header{};
+			// Sniffed from what is there, an entry past the end of the archive reads short
+			const auto size{ cdData000.read(static_cast<u64>(fileInfo.position) * Archive::sectorSize, header.data(),
+				fileInfo.isABin ? 0 : std::min<std::size_t>(fileInfo.size, headerSize)) };
+			extensions[i] = type(header.data(), size, fileInfo.isABin);
+		});
+
+		return extensions;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,24 @@
+#pragma once
+
+#include "Archive.hpp"
+#include "Types.hpp"
+
+#include <cstddef>
+#include <filesystem>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// File types recognized from the first bytes of an entry
+namespace Magic
+{
+	inline constexpr std::size_t headerSize{ 16 };
+
+	// Empty when the header doesn't match any known format
+	std::string_view extension(const char* header, std::size_t size);
+	// Containers are named .bin and unknown formats .dat
+	std::string_view type(const char* data, std::size_t size, bool isABin);
+	// Types of every entry, headers are read in parallel
+	std::vector<std::string_view> extensions(const std::filesystem::path& cdData000Path,
+		std::span<const Archive::CdDataLocFileInfo> filesInfo);
+}
\ No newline at end of file
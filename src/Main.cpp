@@ -1,3 +1,4 @@
+#include "File.hpp"
 #include "JC2Tools.hpp"
 
 #include "fmt/format.h"
@@ -6,12 +7,21 @@
 #include <filesystem>
 #include <iostream>
 #include <limits>
+#include <optional>
 #include <stdexcept>
+#include <string>
 
 int main(int argc, char** argv)
 {
 	try
 	{
+		// A tar stream written to stdout takes it over before anything is printed
+		std::optional<File> tarOutput;
+		if (argc > 3 && std::strcmp(argv[1], "2") == 0 && std::strcmp(argv[3], "-") == 0)
+		{
+			tarOutput.emplace(File::standardOutput());
+		}
+
 		fmt::print("Jade Cocoon 2 Unpacker / Repacker v1.3.0 by Meos\n\n");
 
 		if (argc < 2)
@@ -36,22 +46,187 @@ int main(int argc, char** argv)
 		}
 		else
 		{
+			static constexpr auto invalidArguments
+			{
+				"Invalid arguments\n"
+				"Unpacker arguments: [0] [CDDATA.000 and CDDATA.LOC path] [Unpacked files path] [Options]\n"
+				"Repacker arguments: [1] [Unpacked files path] [CDDATA.000 and CDDATA.LOC path] [Options]\n"
+				"Tar unpacker arguments: [2] [CDDATA.000 and CDDATA.LOC path] [Tar path or - for stdout] [Options]\n"
+				"Tar repacker arguments: [3] [Tar path or - for stdin] [CDDATA.000 and CDDATA.LOC path] [Options]\n"
+				"Catalog arguments: [4] [CDDATA.000 and CDDATA.LOC path] [Catalog path, .json or .csv for text] [Options]\n"
+				"Trace arguments: [5] [CDDATA.000 and CDDATA.LOC path] [Trace path] [Report path] [Options]\n"
+				"Whois arguments: [6] [CDDATA.000 and CDDATA.LOC path] [Offsets path or - for stdin] [Options]\n"
+				"Texture unpacker arguments: [7] [CDDATA.000 and CDDATA.LOC path] [PNG path] [Options]\n"
+				"Search arguments: [8] [CDDATA.000 and CDDATA.LOC path] [Pattern] [Options]\n"
+				"Version diff arguments: [9] [Old CDDATA.000 and CDDATA.LOC path] [New CDDATA.000 and CDDATA.LOC path] [Options]\n"
+				"Batch arguments: [10] [Manifest path] [Options]\n"
+				"Watch arguments: [11] [Unpacked files path] [CDDATA.000 and CDDATA.LOC path] [Options]\n"
+				"Daemon arguments: [12] [CDDATA.000 and CDDATA.LOC path] [Socket path] [Options]\n"
+				"Overlay repacker arguments: [13] [Base CDDATA.000 and CDDATA.LOC path] [CDDATA.000 and CDDATA.LOC path] [Options]\n"
+				"Verify arguments: [14] [CDDATA.000 and CDDATA.LOC path] [Known-good CDDATA.MKL, root hash or -] [Options]\n"
+				"Options:\n"
+				"--direct (O_DIRECT I/O on CDDATA.000)\n"
+				"--generic (unpack with generic names)\n"
+				"--containers (unpack members of .bin and .hbin files)\n"
+				"--layout [Layout path] (repack placement)\n"
+				"--textures [PNG path] (repack edited textures)\n"
+				"--base-lba [LBA] (CDDATA.000 on disc for traces)\n"
+				"--pattern [Pattern] (search another pattern)\n"
+				"--hex (search patterns are hex bytes)\n"
+				"--encoding [ascii, utf16, sjis or all] (search text encoding)\n"
+				"--type [Extension] (search files of a type)\n"
+				"--dir [Directory] (search files of a directory)\n"
+				"--io-limit [Count] (batch I/O in flight)\n"
+				"--store [Store path] (unpack into a deduplicating store)\n"
+				"--debounce [Milliseconds] (watch delay after a save)\n"
+				"--overlay [Overlay path] (overlay repack layer, repeatable)\n"
+				"--update (only write what changed)\n"
+			};
+
+			JC2Tools::Options options;
+			// Options follow the paths, the trace mode has one more and the batch mode one less
+			const auto nbPaths{ std::strcmp(argv[1], "5") == 0 ? 3 : std::strcmp(argv[1], "10") == 0 ? 1 : 2 };
+
+			for (int i{ 2 + nbPaths }; i < argc; ++i)
+			{
+				if (std::strcmp(argv[i], "--direct") == 0)
+				{
+					options.direct = true;
+				}
+				else if (std::strcmp(argv[i], "--generic") == 0)
+				{
+					options.generic = true;
+				}
+				else if (std::strcmp(argv[i], "--containers") == 0)
+				{
+					options.containers = true;
+				}
+				else if (std::strcmp(argv[i], "--layout") == 0 && i + 1 < argc)
+				{
+					options.layout = argv[++i];
+				}
+				else if (std::strcmp(argv[i], "--textures") == 0 && i + 1 < argc)
+				{
+					options.textures = argv[++i];
+				}
+				else if (std::strcmp(argv[i], "--base-lba") == 0 && i + 1 < argc)
+				{
+					options.baseLba = static_cast<u32>(std::stoul(argv[++i], nullptr, 0));
+				}
+				else if (std::strcmp(argv[i], "--pattern") == 0 && i + 1 < argc)
+				{
+					options.patterns.emplace_back(argv[++i]);
+				}
+				else if (std::strcmp(argv[i], "--hex") == 0)
+				{
+					options.hex = true;
+				}
+				else if (std::strcmp(argv[i], "--encoding") == 0 && i + 1 < argc)
+				{
+					options.encoding = argv[++i];
+				}
+				else if (std::strcmp(argv[i], "--type") == 0 && i + 1 < argc)
+				{
+					options.type = argv[++i];
+				}
+				else if (std::strcmp(argv[i], "--dir") == 0 && i + 1 < argc)
+				{
+					options.directory = argv[++i];
+				}
+				else if (std::strcmp(argv[i], "--io-limit") == 0 && i + 1 < argc)
+				{
+					options.ioLimit = static_cast<u32>(std::stoul(argv[++i]));
+				}
+				else if (std::strcmp(argv[i], "--store") == 0 && i + 1 < argc)
+				{
+					options.store = argv[++i];
+				}
+				else if (std::strcmp(argv[i], "--debounce") == 0 && i + 1 < argc)
+				{
+					options.debounce = static_cast<u32>(std::stoul(argv[++i]));
+				}
+				else if (std::strcmp(argv[i], "--overlay") == 0 && i + 1 < argc)
+				{
+					options.overlays.emplace_back(argv[++i]);
+				}
+				else if (std::strcmp(argv[i], "--update") == 0)
+				{
+					options.update = true;
+				}
+				else
+				{
+					throw std::runtime_error{ invalidArguments };
+				}
+			}
+
 			if (std::strcmp(argv[1], "0") == 0 && argc > 3)
 			{
-				JC2Tools::unpacker(argv[2], argv[3]);
+				JC2Tools::unpacker(argv[2], argv[3], options);
 			}
 			else if (std::strcmp(argv[1], "1") == 0 && argc > 3)
 			{
-				JC2Tools::repacker(argv[2], argv[3]);
+				JC2Tools::repacker(argv[2], argv[3], options);
 			}
-			else
+			else if (std::strcmp(argv[1], "2") == 0 && argc > 3)
 			{
-				throw std::runtime_error
+				if (!tarOutput)
 				{
-					"Invalid arguments\n"
-					"Unpacker arguments: [0] [CDDATA.000 and CDDATA.LOC path] [Unpacked files path]\n"
-					"Repacker arguments: [1] [Unpacked files path] [CDDATA.000 and CDDATA.LOC path]\n"
-				};
+					tarOutput.emplace(argv[3], File::Mode::Write);
+				}
+				JC2Tools::unpacker(argv[2], *tarOutput, options);
+			}
+			else if (std::strcmp(argv[1], "3") == 0 && argc > 3)
+			{
+				auto tarInput{ std::strcmp(argv[2], "-") == 0 ? File::standardInput() : File{ argv[2], File::Mode::Read } };
+				JC2Tools::repacker(tarInput, argv[3], options);
+			}
+			else if (std::strcmp(argv[1], "4") == 0 && argc > 3)
+			{
+				JC2Tools::catalog(argv[2], argv[3], options);
+			}
+			else if (std::strcmp(argv[1], "5") == 0 && argc > 4)
+			{
+				JC2Tools::trace(argv[2], argv[3], argv[4], options);
+			}
+			else if (std::strcmp(argv[1], "6") == 0 && argc > 3)
+			{
+				JC2Tools::whois(argv[2], argv[3], options);
+			}
+			else if (std::strcmp(argv[1], "7") == 0 && argc > 3)
+			{
+				JC2Tools::texturesToPng(argv[2], argv[3], options);
+			}
+			else if (std::strcmp(argv[1], "8") == 0 && argc > 3)
+			{
+				JC2Tools::search(argv[2], argv[3], options);
+			}
+			else if (std::strcmp(argv[1], "9") == 0 && argc > 3)
+			{
+				JC2Tools::versionDiff(argv[2], argv[3], options);
+			}
+			else if (std::strcmp(argv[1], "10") == 0 && argc > 2)
+			{
+				JC2Tools::batch(argv[2], options);
+			}
+			else if (std::strcmp(argv[1], "11") == 0 && argc > 3)
+			{
+				JC2Tools::watch(argv[2], argv[3], options);
+			}
+			else if (std::strcmp(argv[1], "12") == 0 && argc > 3)
+			{
+				JC2Tools::daemon(argv[2], argv[3], options);
+			}
+			else if (std::strcmp(argv[1], "13") == 0 && argc > 3)
+			{
+				JC2Tools::overlayRepacker(argv[2], argv[3], options);
+			}
+			else if (std::strcmp(argv[1], "14") == 0 && argc > 3)
+			{
+				JC2Tools::verify(argv[2], argv[3], options);
+			}
+			else
+			{
+				throw std::runtime_error{ invalidArguments };
 			}
 		}
 	}
@@ -0,0 +1,278 @@
+#include "Merkle.hpp"
+
+#include "File.hpp"
+#include "Parallel.hpp"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+namespace Merkle
+{
+	static u64 nbLeaves(u64 archiveSize, u64 groupSize = Merkle::groupSize)
+	{
+		return std::max<u64>(1, (archiveSize + groupSize - 1) / groupSize);
+	}
+
+	static s64 modificationTime(const std::filesystem::path& path)
+	{
+		return static_cast<s64>(std::filesystem::last_write_time(path).time_since_epoch().count());
+	}
+
+	static Hash::Sha256 leaf(const MappedFile& archive, u64 group)
+	{
+		const auto offset{ std::min<u64>(group * groupSize, archive.size()) };
+		return Hash::sha256(archive.data() + offset, static_cast<std::size_t>(std::min(groupSize, archive.size() - offset)));
+	}
+
+	// Prefixed so a node can't be taken for a leaf
+	static Hash::Sha256 node(const std::vector<Hash::Sha256>& children, u64 index)
+	{
+		if (2 * index + 1 >= children.size())
+		{
+			return children[2 * index];
+		}
+
+		u8 data[1 + 2 * sizeof(Hash::Sha256)]{ 1 };
+		std::memcpy(data + 1, children[2 * index].data(), sizeof(Hash::Sha256));
+		std::memcpy(data + 1 + sizeof(Hash::Sha256), children[2 * index + 1].data(), sizeof(Hash::Sha256));
+		return Hash::sha256(data, sizeof(data));
+	}
+
+	Tree Tree::build(const std::filesystem::path& cdData000Path)
+	{
+		const MappedFile archive{ cdData000Path };
+		Tree tree;
+		tree.m_header = { magic, formatVersion, groupSectors, archive.size(), modificationTime(cdData000Path) };
+
+		auto& leaves{ tree.m_levels.emplace_back(nbLeaves(archive.size())) };
+
+		Parallel::forEach(leaves.size(), [&](std::size_t i)
+		{
+			leaves[i] = leaf(archive, i);
+		});
+
+		tree.buildNodes();
+		return tree;
+	}
+
+	Tree::Tree(const std::filesystem::path& path)
+	{
+		File file{ path, File::Mode::Read };
+
+		if (file.read(0, &m_header, sizeof(m_header)) != sizeof(m_header) || m_header.magic != magic)
+		{
+			throw std::runtime_error{ fmt::format("\"{}\" is invalid", path.string()) };
+		}
+		else if (m_header.formatVersion != formatVersion)
+		{
+			throw std::runtime_error{ fmt::format("Merkle tree format {} is not supported", m_header.formatVersion) };
+		}
+		else if (m_header.groupSectors == 0)
+		{
+			throw std::runtime_error{ fmt::format("\"{}\" is invalid", path.string()) };
+		}
+
+		// Sizes of the levels follow from the size of the archive
+		u64 position{ sizeof(m_header) };
+
+		for (auto size{ nbLeaves(m_header.archiveSize, static_cast<u64>(m_header.groupSectors) * Archive::sectorSize) }; ; size = (size + 1) / 2)
+		{
+			auto& level{ m_levels.emplace_back(size) };
+			const auto levelSize{ level.size() * sizeof(Hash::Sha256) };
+
+			if (file.read(position, level.data(), levelSize) != levelSize)
+			{
+				throw std::runtime_error{ fmt::format("\"{}\" is truncated", path.string()) };
+			}
+
+			position += levelSize;
+
+			if (level.size() == 1)
+			{
+				break;
+			}
+		}
+	}
+
+	void Tree::save(const std::filesystem::path& path) const
+	{
+		// Replaced whole so an interrupted save leaves the previous tree
+		const std::filesystem::path temp{ fmt::format("{}.tmp", path.string()) };
+		{
+			File file{ temp, File::Mode::Write };
+			std::vector<File::Segment> segments{ { &m_header, sizeof(m_header) } };
+
+			for (const auto& level : m_levels)
+			{
+				segments.push_back({ level.data(), level.size() * sizeof(Hash::Sha256) });
+			}
+
+			file.write(0, segments);
+		}
+		std::filesystem::rename(temp, path);
+	}
+
+	bool Tree::isCurrent(const std::filesystem::path& cdData000Path) const
+	{
+		return m_header.groupSectors == groupSectors && std::filesystem::file_size(cdData000Path) == m_header.archiveSize &&
+			modificationTime(cdData000Path) == m_header.archiveTime;
+	}
+
+	void Tree::touch(u64 offset, u64 size)
+	{
+		for (auto group{ offset / groupSize }; group * groupSize < offset + size; ++group)
+		{
+			if (m_touched.empty() || m_touched.back() != group)
+			{
+				m_touched.push_back(group);
+			}
+		}
+	}
+
+	u64 Tree::update(const std::filesystem::path& cdData000Path)
+	{
+		const MappedFile archive{ cdData000Path };
+		auto& leaves{ m_levels.front() };
+		const auto nbLeaves{ Merkle::nbLeaves(archive.size()) };
+		const auto reshaped{ nbLeaves != leaves.size() };
+
+		// A resized archive changes its last group and adds or drops the ones after it
+		if (archive.size() != m_header.archiveSize)
+		{
+			for (auto group{ std::min(archive.size(), m_header.archiveSize) / groupSize }; group < nbLeaves; ++group)
+			{
+				m_touched.push_back(group);
+			}
+		}
+
+		std::sort(m_touched.begin(), m_touched.end());
+		m_touched.erase(std::unique(m_touched.begin(), m_touched.end()), m_touched.end());
+		m_touched.erase(std::lower_bound(m_touched.begin(), m_touched.end(), nbLeaves), m_touched.end());
+		leaves.resize(nbLeaves);
+
+		Parallel::forEach(m_touched.size(), [&](std::size_t i)
+		{
+			leaves[m_touched[i]] = leaf(archive, m_touched[i]);
+		});
+
+		if (reshaped)
+		{
+			buildNodes();
+		}
+		else
+		{
+			// Only the ancestors of the touched groups change
+			auto indices{ m_touched };
+
+			for (std::size_t level{ 1 }; level < m_levels.size(); ++level)
+			{
+				for (auto& index : indices)
+				{
+					index /= 2;
+				}
+				indices.erase(std::unique(indices.begin(), indices.end()), indices.end());
+
+				for (const auto index : indices)
+				{
+					m_levels[level][index] = node(m_levels[level - 1], index);
+				}
+			}
+		}
+
+		m_header.archiveSize = archive.size();
+		m_header.archiveTime = modificationTime(cdData000Path);
+
+		const auto nbHashed{ static_cast<u64>(m_touched.size()) };
+		m_touched.clear();
+		return nbHashed;
+	}
+
+	std::vector<u64> Tree::diff(const Tree& other) const
+	{
+		if (m_header.groupSectors != other.m_header.groupSectors)
+		{
+			throw std::runtime_error{ "Merkle trees of different group sizes can't be compared" };
+		}
+
+		const auto& leaves{ m_levels.front() };
+		const auto& otherLeaves{ other.m_levels.front() };
+		std::vector<u64> groups;
+
+		if (leaves.size() != otherLeaves.size())
+		{
+			// Shapes differ, the leaves are compared one by one
+			for (u64 group{}; group < std::max(leaves.size(), otherLeaves.size()); ++group)
+			{
+				if (group >= leaves.size() || group >= otherLeaves.size() || leaves[group] != otherLeaves[group])
+				{
+					groups.push_back(group);
+				}
+			}
+
+			return groups;
+		}
+
+		std::vector<std::pair<std::size_t, u64>> nodes{ { m_levels.size() - 1, 0 } };
+
+		while (!nodes.empty())
+		{
+			const auto [level, index]{ nodes.back() };
+			nodes.pop_back();
+
+			if (m_levels[level][index] == other.m_levels[level][index])
+			{
+				continue;
+			}
+			else if (level == 0)
+			{
+				groups.push_back(index);
+				continue;
+			}
+
+			// Right child first so groups come out in order
+			if (2 * index + 1 < m_levels[level - 1].size())
+			{
+				nodes.emplace_back(level - 1, 2 * index + 1);
+			}
+			nodes.emplace_back(level - 1, 2 * index);
+		}
+
+		return groups;
+	}
+
+	const Hash::Sha256& Tree::root() const
+	{
+		return m_levels.back().front();
+	}
+
+	u64 Tree::archiveSize() const
+	{
+		return m_header.archiveSize;
+	}
+
+	u64 Tree::nbGroups() const
+	{
+		return m_levels.front().size();
+	}
+
+	void Tree::buildNodes()
+	{
+		m_levels.resize(1);
+
+		while (m_levels.back().size() > 1)
+		{
+			const auto& children{ m_levels.back() };
+			std::vector<Hash::Sha256> level((children.size() + 1) / 2);
+
+			for (u64 i{}; i < level.size(); ++i)
+			{
+				level[i] = node(children, i);
+			}
+
+			m_levels.push_back(std::move(level));
+		}
+	}
+}
\ No newline at end of file
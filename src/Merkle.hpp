@@ -0,0 +1,66 @@
+#pragma once
+
+#include "Archive.hpp"
+#include "Hash.hpp"
+#include "Types.hpp"
+
+#include <array>
+#include <filesystem>
+#include <vector>
+
+// SHA-256 Merkle tree over fixed groups of sectors of CDDATA.000, kept next to it in a sidecar so a patch
+// or a repack re-hashes only the groups it wrote and comparing with a known-good build walks only differing subtrees
+namespace Merkle
+{
+	inline constexpr auto filename{ "CDDATA.MKL" };
+	inline constexpr std::array<char, 8> magic{ 'J', 'C', '2', 'M', 'R', 'K', 'L', 'T' };
+	inline constexpr u32 formatVersion{ 1 };
+	// Sectors of a leaf, 128 KiB
+	inline constexpr u32 groupSectors{ 64 };
+	inline constexpr u64 groupSize{ static_cast<u64>(groupSectors) * Archive::sectorSize };
+
+	// Little endian, followed by the levels from the leaves up to the root
+	struct Header
+	{
+		std::array<char, 8> magic;
+		u32 formatVersion;
+		u32 groupSectors;
+		u64 archiveSize;
+		// Modification time of CDDATA.000 when the tree was brought up to date, another one means the tree is stale
+		s64 archiveTime;
+	};
+
+	static_assert(sizeof(Header) == 32);
+
+	class Tree
+	{
+	public:
+		// Every group hashed in parallel
+		static Tree build(const std::filesystem::path& cdData000Path);
+
+		explicit Tree(const std::filesystem::path& path);
+
+		void save(const std::filesystem::path& path) const;
+		// Same size and modification time as when it was last hashed
+		bool isCurrent(const std::filesystem::path& cdData000Path) const;
+		// Groups overlapping the bytes are re-hashed by the next update()
+		void touch(u64 offset, u64 size);
+		// Re-hashes the touched groups and their ancestors, the archive may have been resized, returns the number of groups hashed
+		u64 update(const std::filesystem::path& cdData000Path);
+		// Groups whose hash differs, found from the root through differing nodes only when both have as many groups
+		std::vector<u64> diff(const Tree& other) const;
+
+		const Hash::Sha256& root() const;
+		u64 archiveSize() const;
+		u64 nbGroups() const;
+	private:
+		Tree() = default;
+
+		void buildNodes();
+
+		Header m_header;
+		// Leaves first, an odd last node is promoted to the level above as is
+		std::vector<std::vector<Hash::Sha256>> m_levels;
+		std::vector<u64> m_touched;
+	};
+}
\ No newline at end of file
@@ -0,0 +1,274 @@
+#include "Palette.hpp"
+
+#include <algorithm>
+#include <array>
+#include <limits>
+#include <unordered_map>
+#include <vector>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace Palette
+{
+	static u32 channel(u32 color, u32 channel)
+	{
+		return color >> channel * 8 & 0xFF;
+	}
+
+	static u32 distance(u32 lhs, u32 rhs)
+	{
+		u32 distance{};
+		for (u32 i{}; i < 4; ++i)
+		{
+			const auto difference{ static_cast<s32>(channel(lhs, i)) - static_cast<s32>(channel(rhs, i)) };
+			distance += static_cast<u32>(difference * difference);
+		}
+		return distance;
+	}
+
+	u32 nearest(std::span<const u32> palette, u32 color)
+	{
+		u32 bestIndex{}, bestDistance{ std::numeric_limits<u32>::max() };
+		std::size_t i{};
+
+#ifdef __SSE2__
+		// Four colors at a time: channels widened to 16 bits, squared and summed by pairs with madd
+		const auto zero{ _mm_setzero_si128() };
+		const auto target{ _mm_unpacklo_epi8(_mm_set1_epi32(static_cast<int>(color)), zero) };
+		alignas(16) std::array<u32, 4> distances;
+
+		for (; i + 4 <= palette.size(); i += 4)
+		{
+			const auto colors{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(palette.data() + i)) };
+			const auto low{ _mm_sub_epi16(_mm_unpacklo_epi8(colors, zero), target) };
+			const auto high{ _mm_sub_epi16(_mm_unpackhi_epi8(colors, zero), target) };
+			const auto lowSquares{ _mm_castsi128_ps(_mm_madd_epi16(low, low)) };
+			const auto highSquares{ _mm_castsi128_ps(_mm_madd_epi16(high, high)) };
+			const auto even{ _mm_castps_si128(_mm_shuffle_ps(lowSquares, highSquares, _MM_SHUFFLE(2, 0, 2, 0))) };
+			const auto odd{ _mm_castps_si128(_mm_shuffle_ps(lowSquares, highSquares, _MM_SHUFFLE(3, 1, 3, 1))) };
+			_mm_store_si128(reinterpret_cast<__m128i*>(distances.data()), _mm_add_epi32(even, odd));
+
+			for (u32 j{}; j < 4; ++j)
+			{
+				if (distances[j] < bestDistance)
+				{
+					bestDistance = distances[j];
+					bestIndex = static_cast<u32>(i + j);
+				}
+			}
+		}
+#endif
+		for (; i < palette.size(); ++i)
+		{
+			if (const auto colorDistance{ distance(palette[i], color) }; colorDistance < bestDistance)
+			{
+				bestDistance = colorDistance;
+				bestIndex = static_cast<u32>(i);
+			}
+		}
+
+		return bestIndex;
+	}
+
+	struct Color
+	{
+		u32 color;
+		u32 count;
+	};
+
+	// Splits the box with the widest channel at its weighted median until there are enough boxes
+	static void medianCut(std::vector<Color> colors, std::span<u32> palette)
+	{
+		struct Box
+		{
+			std::size_t begin;
+			std::size_t end;
+		};
+
+		const auto widestChannel{ [&](const Box& box)
+		{
+			std::array<u32, 4> minimum{ 0xFF, 0xFF, 0xFF, 0xFF }, maximum{};
+			for (auto i{ box.begin }; i < box.end; ++i)
+			{
+				for (u32 c{}; c < 4; ++c)
+				{
+					minimum[c] = std::min(minimum[c], channel(colors[i].color, c));
+					maximum[c] = std::max(maximum[c], channel(colors[i].color, c));
+				}
+			}
+
+			std::pair<u32, u32> widest{};
+			for (u32 c{}; c < 4; ++c)
+			{
+				widest = std::max(widest, std::pair{ maximum[c] - minimum[c], c });
+			}
+			return widest;
+		}};
+
+		std::vector<Box> boxes{ { 0, colors.size() } };
+
+		while (boxes.size() < palette.size())
+		{
+			std::size_t boxIndex{};
+			std::pair<u32, u32> widest{};
+
+			for (std::size_t i{}; i < boxes.size(); ++i)
+			{
+				if (boxes[i].end - boxes[i].begin > 1)
+				{
+					if (const auto boxWidest{ widestChannel(boxes[i]) }; boxWidest.first > widest.first)
+					{
+						widest = boxWidest;
+						boxIndex = i;
+					}
+				}
+			}
+
+			if (widest.first == 0)
+			{
+				break;
+			}
+
+			auto& box{ boxes[boxIndex] };
+			const auto c{ widest.second };
+			std::sort(colors.begin() + box.begin, colors.begin() + box.end,
+				[c](const Color& lhs, const Color& rhs) { return channel(lhs.color, c) < channel(rhs.color, c); });
+
+			u64 total{}, half{};
+			for (auto i{ box.begin }; i < box.end; ++i)
+			{
+				total += colors[i].count;
+			}
+
+			// Both halves keep a color even when one color weighs more than the rest of the box
+			auto split{ box.begin };
+			while (split < box.end - 2 && (half += colors[split].count) * 2 < total)
+			{
+				++split;
+			}
+
+			const Box second{ split + 1, box.end };
+			box.end = split + 1;
+			boxes.push_back(second);
+		}
+
+		std::fill(palette.begin(), palette.end(), 0);
+
+		for (std::size_t i{}; i < boxes.size(); ++i)
+		{
+			std::array<u64, 4> sums{};
+			u64 count{};
+
+			for (auto j{ boxes[i].begin }; j < boxes[i].end; ++j)
+			{
+				for (u32 c{}; c < 4; ++c)
+				{
+					sums[c] += static_cast<u64>(channel(colors[j].color, c)) * colors[j].count;
+				}
+				count += colors[j].count;
+			}
+
+			if (count == 0)
+			{
+				continue;
+			}
+
+			u32 color{};
+			for (u32 c{}; c < 4; ++c)
+			{
+				color |= static_cast<u32>((sums[c] + count / 2) / count) << c * 8;
+			}
+			palette[i] = color;
+		}
+	}
+
+	void quantize(std::span<const u32> pixels, std::span<const u32> referencePixels, std::span<const u8> referenceIndices,
+		std::span<u32> palette, std::span<u8> indices)
+	{
+		std::vector<bool> used(palette.size());
+		std::unordered_map<u32, u32> paletteIndices;
+
+		for (auto i{ static_cast<u32>(palette.size()) }; i-- > 0;)
+		{
+			paletteIndices[palette[i]] = i;
+		}
+
+		// Unchanged pixels and colors already in the palette
+		std::unordered_map<u32, u32> newColors;
+		std::vector<std::size_t> pending;
+
+		for (std::size_t i{}; i < pixels.size(); ++i)
+		{
+			if (i < referencePixels.size() && pixels[i] == referencePixels[i] && referenceIndices[i] < palette.size())
+			{
+				indices[i] = referenceIndices[i];
+				used[indices[i]] = true;
+			}
+			else if (const auto it{ paletteIndices.find(pixels[i]) }; it != paletteIndices.end())
+			{
+				indices[i] = static_cast<u8>(it->second);
+				used[it->second] = true;
+			}
+			else
+			{
+				++newColors[pixels[i]];
+				pending.push_back(i);
+			}
+		}
+
+		if (newColors.empty())
+		{
+			return;
+		}
+
+		// New colors in the free entries
+		if (const auto nbFree{ static_cast<std::size_t>(std::count(used.begin(), used.end(), false)) }; newColors.size() <= nbFree)
+		{
+			u32 entry{};
+
+			for (auto& [color, index] : newColors)
+			{
+				while (used[entry])
+				{
+					++entry;
+				}
+				palette[entry] = color;
+				index = entry++;
+			}
+
+			for (const auto i : pending)
+			{
+				indices[i] = static_cast<u8>(newColors[pixels[i]]);
+			}
+			return;
+		}
+
+		// Too many colors, every pixel is mapped to a new palette
+		std::unordered_map<u32, u32> counts;
+		for (const auto pixel : pixels)
+		{
+			++counts[pixel];
+		}
+
+		std::vector<Color> colors;
+		colors.reserve(counts.size());
+		for (const auto& [color, count] : counts)
+		{
+			colors.push_back({ color, count });
+		}
+
+		medianCut(std::move(colors), palette);
+
+		for (auto& [color, index] : counts)
+		{
+			index = nearest(palette, color);
+		}
+
+		for (std::size_t i{}; i < pixels.size(); ++i)
+		{
+			indices[i] = static_cast<u8>(counts[pixels[i]]);
+		}
+	}
+}
\ No newline at end of file
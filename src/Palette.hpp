@@ -0,0 +1,18 @@
+#pragma once
+
+#include "Types.hpp"
+
+#include <span>
+
+// Colors are 8-bit RGBA read as little endian u32 (R in the low byte)
+namespace Palette
+{
+	// Index of the closest color by squared RGBA distance
+	u32 nearest(std::span<const u32> palette, u32 color);
+
+	// Maps pixels to the palette, pixels equal to the reference keep their reference index and colors missing
+	// from the palette take the entries no pixel uses anymore. When they don't fit, the palette is rebuilt
+	// by median cut. The reference can be empty.
+	void quantize(std::span<const u32> pixels, std::span<const u32> referencePixels, std::span<const u8> referenceIndices,
+		std::span<u32> palette, std::span<u8> indices);
+}
\ No newline at end of file
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Parallel
+{
+	inline std::size_t nbThreads()
+	{
+		return std::max(1u, std::thread::hardware_concurrency());
+	}
+
+	// Set on the threads running a forEach
+	inline thread_local bool isWorker{};
+
+	// Calls function(i) for every i in [0, count) over all hardware threads, the first exception thrown is rethrown,
+	// a forEach called by function runs on the thread calling it so nesting never adds threads
+	template <typename Function>
+	void forEach(std::size_t count, Function&& function)
+	{
+		std::atomic<std::size_t> next{};
+		std::exception_ptr exception;
+		std::mutex exceptionMutex;
+		const auto nested{ isWorker };
+
+		const auto worker{ [&]()
+		{
+			isWorker = true;
+
+			for (auto i{ next++ }; i < count; i = next++)
+			{
+				try
+				{
+					function(i);
+				}
+				catch (...)
+				{
+					const std::lock_guard lock{ exceptionMutex };
+					if (!exception)
+					{
+						exception = std::current_exception();
+					}
+					next = count;
+				}
+			}
+
+			isWorker = nested;
+		}};
+
+		{
+			std::vector<std::jthread> threads;
+			for (std::size_t i{ 1 }; i < (nested ? 1 : std::min(nbThreads(), count)); ++i)
+			{
+				threads.emplace_back(worker);
+			}
+			worker();
+		}
+
+		if (exception)
+		{
+			std::rethrow_exception(exception);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,373 @@
+#include "Png.hpp"
+
+#include "Deflate.hpp"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+
+namespace Png
+{
+	static constexpr std::array<u8, 8> signature{ 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+	static constexpr std::size_t bytesPerPixel{ 4 };
+
+	static constexpr auto crcTable{ []()
+	{
+		std::array<u32, 256> table{};
+
+		for (u32 i{}; i < table.size(); ++i)
+		{
+			auto value{ i };
+			for (u32 j{}; j < 8; ++j)
+			{
+				value = value & 1 ? 0xEDB88320 ^ value >> 1 : value >> 1;
+			}
+			table[i] = value;
+		}
+
+		return table;
+	}() };
+
+	static u32 crc32(u32 crc, std::span<const u8> data)
+	{
+		crc = ~crc;
+		for (const auto byte : data)
+		{
+			crc = crcTable[(crc ^ byte) & 0xFF] ^ crc >> 8;
+		}
+		return ~crc;
+	}
+
+	static u32 adler32(std::span<const u8> data)
+	{
+		// Largest number of bytes summed before the 32-bit sums could overflow
+		static constexpr std::size_t nmax{ 5552 };
+		u32 a{ 1 }, b{};
+
+		while (!data.empty())
+		{
+			const auto size{ std::min(data.size(), nmax) };
+			for (const auto byte : data.first(size))
+			{
+				a += byte;
+				b += a;
+			}
+			a %= 65521;
+			b %= 65521;
+			data = data.subspan(size);
+		}
+
+		return b << 16 | a;
+	}
+
+	static void writeU32(std::vector<u8>& output, u32 value)
+	{
+		output.insert(output.end(), { static_cast<u8>(value >> 24), static_cast<u8>(value >> 16), static_cast<u8>(value >> 8), static_cast<u8>(value) });
+	}
+
+	static void writeChunk(std::vector<u8>& output, std::string_view type, std::span<const u8> data)
+	{
+		writeU32(output, static_cast<u32>(data.size()));
+		const auto typeOffset{ output.size() };
+		output.insert(output.end(), type.begin(), type.end());
+		output.insert(output.end(), data.begin(), data.end());
+		writeU32(output, crc32(0, { output.data() + typeOffset, output.size() - typeOffset }));
+	}
+
+	static u8 paeth(u8 left, u8 up, u8 upLeft)
+	{
+		const auto estimate{ left + up - upLeft };
+		const auto distanceLeft{ std::abs(estimate - left) }, distanceUp{ std::abs(estimate - up) }, distanceUpLeft{ std::abs(estimate - upLeft) };
+
+		if (distanceLeft <= distanceUp && distanceLeft <= distanceUpLeft)
+		{
+			return left;
+		}
+		return distanceUp <= distanceUpLeft ? up : upLeft;
+	}
+
+	// Each row gets the filter with the smallest sum of absolute residuals
+	static std::vector<u8> filter(u32 width, u32 height, std::span<const u8> pixels)
+	{
+		const std::size_t rowSize{ static_cast<std::size_t>(width) * bytesPerPixel };
+		std::vector<u8> filtered((rowSize + 1) * height);
+		std::array<std::vector<u8>, 5> candidates;
+		candidates.fill(std::vector<u8>(rowSize));
+		const std::vector<u8> zeroRow(rowSize);
+
+		for (u32 y{}; y < height; ++y)
+		{
+			const auto* const row{ pixels.data() + y * rowSize };
+			const auto* const up{ y ? row - rowSize : zeroRow.data() };
+
+			for (std::size_t i{}; i < rowSize; ++i)
+			{
+				const u8 left{ i >= bytesPerPixel ? row[i - bytesPerPixel] : u8{} };
+				const u8 upLeft{ i >= bytesPerPixel ? up[i - bytesPerPixel] : u8{} };
+
+				candidates[0][i] = row[i];
+				candidates[1][i] = static_cast<u8>(row[i] - left);
+				candidates[2][i] = static_cast<u8>(row[i] - up[i]);
+				candidates[3][i] = static_cast<u8>(row[i] - (left + up[i]) / 2);
+				candidates[4][i] = static_cast<u8>(row[i] - paeth(left, up[i], upLeft));
+			}
+
+			std::size_t bestFilter{};
+			u64 bestSum{ ~u64{} };
+
+			for (std::size_t f{}; f < candidates.size(); ++f)
+			{
+				u64 sum{};
+				for (const auto value : candidates[f])
+				{
+					sum += value < 128 ? value : 256 - value;
+				}
+
+				if (sum < bestSum)
+				{
+					bestSum = sum;
+					bestFilter = f;
+				}
+			}
+
+			auto* const output{ filtered.data() + y * (rowSize + 1) };
+			output[0] = static_cast<u8>(bestFilter);
+			std::copy(candidates[bestFilter].begin(), candidates[bestFilter].end(), output + 1);
+		}
+
+		return filtered;
+	}
+
+	std::vector<u8> encode(u32 width, u32 height, std::span<const u8> pixels)
+	{
+		if (pixels.size() != static_cast<std::size_t>(width) * height * bytesPerPixel)
+		{
+			throw std::runtime_error{ fmt::format("Invalid {}x{} image", width, height) };
+		}
+
+		std::vector<u8> png{ signature.begin(), signature.end() };
+
+		std::vector<u8> header;
+		writeU32(header, width);
+		writeU32(header, height);
+		// 8-bit depth, truecolor with alpha, deflate, adaptive filtering, no interlace
+		header.insert(header.end(), { 8, 6, 0, 0, 0 });
+		writeChunk(png, "IHDR", header);
+
+		const auto filtered{ filter(width, height, pixels) };
+		const auto compressed{ Deflate::compress(filtered) };
+
+		// zlib stream: 32 KiB window deflate, then the Adler-32 of the data
+		std::vector<u8> data{ 0x78, 0x01 };
+		data.insert(data.end(), compressed.begin(), compressed.end());
+		writeU32(data, adler32(filtered));
+		writeChunk(png, "IDAT", data);
+
+		writeChunk(png, "IEND", {});
+		return png;
+	}
+
+	void write(const std::filesystem::path& path, u32 width, u32 height, std::span<const u8> pixels)
+	{
+		const auto png{ encode(width, height, pixels) };
+		std::ofstream file{ path, std::ofstream::binary };
+		file.write(reinterpret_cast<const char*>(png.data()), png.size());
+	}
+
+	static u32 readU32(const u8* data)
+	{
+		return static_cast<u32>(data[0]) << 24 | data[1] << 16 | data[2] << 8 | data[3];
+	}
+
+	static void unfilter(std::span<u8> data, u32 height, std::size_t rowSize, std::size_t pixelSize)
+	{
+		if (data.size() < (rowSize + 1) * height)
+		{
+			throw std::runtime_error{ "PNG is truncated" };
+		}
+
+		for (u32 y{}; y < height; ++y)
+		{
+			const auto filterType{ data[y * (rowSize + 1)] };
+			auto* const row{ data.data() + y * (rowSize + 1) + 1 };
+			const auto* const up{ y ? row - rowSize - 1 : nullptr };
+
+			for (std::size_t i{}; i < rowSize; ++i)
+			{
+				const u8 left{ i >= pixelSize ? row[i - pixelSize] : u8{} };
+				const u8 above{ up ? up[i] : u8{} };
+				const u8 upLeft{ up && i >= pixelSize ? up[i - pixelSize] : u8{} };
+
+				switch (filterType)
+				{
+				case 0:
+					break;
+				case 1:
+					row[i] += left;
+					break;
+				case 2:
+					row[i] += above;
+					break;
+				case 3:
+					row[i] += static_cast<u8>((left + above) / 2);
+					break;
+				case 4:
+					row[i] += paeth(left, above, upLeft);
+					break;
+				default:
+					throw std::runtime_error{ "PNG is invalid" };
+				}
+			}
+		}
+	}
+
+	Image decode(std::span<const u8> png)
+	{
+		if (png.size() < signature.size() || !std::equal(signature.begin(), signature.end(), png.begin()))
+		{
+			throw std::runtime_error{ "PNG is invalid" };
+		}
+
+		u32 width{}, height{};
+		u8 bitDepth{}, colorType{}, interlace{};
+		std::vector<u8> data, palette;
+		std::vector<u8> transparency;
+
+		for (auto chunk{ png.subspan(signature.size()) }; chunk.size() >= 12;)
+		{
+			const auto size{ readU32(chunk.data()) };
+			if (size > chunk.size() - 12)
+			{
+				throw std::runtime_error{ "PNG is truncated" };
+			}
+
+			const std::string_view type{ reinterpret_cast<const char*>(chunk.data() + 4), 4 };
+			const auto content{ chunk.subspan(8, size) };
+
+			if (type == "IHDR" && size >= 13)
+			{
+				width = readU32(content.data());
+				height = readU32(content.data() + 4);
+				bitDepth = content[8];
+				colorType = content[9];
+				interlace = content[12];
+			}
+			else if (type == "PLTE")
+			{
+				palette.assign(content.begin(), content.end());
+			}
+			else if (type == "tRNS")
+			{
+				transparency.assign(content.begin(), content.end());
+			}
+			else if (type == "IDAT")
+			{
+				data.insert(data.end(), content.begin(), content.end());
+			}
+			else if (type == "IEND")
+			{
+				break;
+			}
+
+			chunk = chunk.subspan(12 + size);
+		}
+
+		static constexpr std::array<u8, 7> channels{ 1, 0, 3, 1, 2, 0, 4 };
+
+		if (width == 0 || height == 0 || interlace != 0 || colorType >= channels.size() || channels[colorType] == 0 ||
+			(bitDepth != 8 && bitDepth != 16 && !(colorType == 3 || colorType == 0)) || data.size() < 2)
+		{
+			throw std::runtime_error{ "PNG format is not supported" };
+		}
+
+		const auto nbBits{ static_cast<std::size_t>(channels[colorType]) * bitDepth };
+		const auto rowSize{ (width * nbBits + 7) / 8 };
+
+		// zlib header, then the raw deflate stream
+		auto raw{ Deflate::decompress(std::span{ data }.subspan(2), (rowSize + 1) * height) };
+		unfilter(raw, height, rowSize, std::max<std::size_t>(nbBits / 8, 1));
+
+		Image image{ width, height, std::vector<u8>(static_cast<std::size_t>(width) * height * bytesPerPixel) };
+
+		for (u32 y{}; y < height; ++y)
+		{
+			const auto* const row{ raw.data() + y * (rowSize + 1) + 1 };
+
+			for (u32 x{}; x < width; ++x)
+			{
+				auto* const pixel{ image.pixels.data() + (static_cast<std::size_t>(y) * width + x) * bytesPerPixel };
+
+				// Samples below 8 bits are packed from the most significant bit
+				const auto sample{ [&](u32 channel)
+				{
+					const auto index{ static_cast<std::size_t>(x) * channels[colorType] + channel };
+
+					if (bitDepth >= 8)
+					{
+						return static_cast<u32>(row[index * (bitDepth / 8)]);
+					}
+					return static_cast<u32>(row[index * bitDepth / 8] >> (8 - bitDepth - index * bitDepth % 8) & ((1 << bitDepth) - 1));
+				}};
+
+				switch (colorType)
+				{
+				case 0:
+				case 4:
+				{
+					const auto gray{ bitDepth >= 8 ? sample(0) : sample(0) * 255 / ((1 << bitDepth) - 1) };
+					pixel[0] = pixel[1] = pixel[2] = static_cast<u8>(gray);
+					pixel[3] = colorType == 4 ? static_cast<u8>(sample(1)) : 0xFF;
+					break;
+				}
+				case 2:
+				case 6:
+					for (u32 channel{}; channel < 3; ++channel)
+					{
+						pixel[channel] = static_cast<u8>(sample(channel));
+					}
+					pixel[3] = colorType == 6 ? static_cast<u8>(sample(3)) : 0xFF;
+					break;
+				case 3:
+				{
+					const auto index{ sample(0) };
+					if (index * 3 + 2 >= palette.size())
+					{
+						throw std::runtime_error{ "PNG is invalid" };
+					}
+					std::copy_n(palette.data() + index * 3, 3, pixel);
+					pixel[3] = index < transparency.size() ? transparency[index] : 0xFF;
+					break;
+				}
+				}
+			}
+		}
+
+		return image;
+	}
+
+	Image read(const std::filesystem::path& path)
+	{
+		std::ifstream file{ path, std::ifstream::binary };
+		const std::vector<u8> png{ std::istreambuf_iterator<char>{ file }, std::istreambuf_iterator<char>{} };
+
+		if (!file.eof() && !file)
+		{
+			throw std::runtime_error{ fmt::format("Can't read \"{}\"", path.string()) };
+		}
+
+		try
+		{
+			return decode(png);
+		}
+		catch (const std::exception& e)
+		{
+			throw std::runtime_error{ fmt::format("\"{}\": {}", path.string(), e.what()) };
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "Types.hpp"
+
+#include <filesystem>
+#include <span>
+#include <vector>
+
+// 8-bit RGBA PNG images
+namespace Png
+{
+	// Pixels are width * height * 4 bytes ordered R, G, B, A
+	std::vector<u8> encode(u32 width, u32 height, std::span<const u8> pixels);
+	void write(const std::filesystem::path& path, u32 width, u32 height, std::span<const u8> pixels);
+
+	struct Image
+	{
+		u32 width;
+		u32 height;
+		std::vector<u8> pixels;
+	};
+
+	// Non interlaced images of any color type are converted to 8-bit RGBA, 16-bit channels are truncated
+	Image decode(std::span<const u8> png);
+	Image read(const std::filesystem::path& path);
+}
\ No newline at end of file
@@ -0,0 +1,61 @@
+#include "ReadPlanner.hpp"
+
+#include "File.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+namespace ReadPlanner
+{
+	Plan plan(std::span<const Archive::CdDataLocFileInfo> filesInfo, u64 alignment, u64 maxReadSize, u64 maxGap)
+	{
+		Plan plan{ .order = std::vector<u32>(filesInfo.size()), .reads = {}, .maxReadSize = 0 };
+		std::iota(plan.order.begin(), plan.order.end(), 0u);
+		std::stable_sort(plan.order.begin(), plan.order.end(),
+			[&filesInfo](u32 a, u32 b)
+			{
+				return filesInfo[a].position < filesInfo[b].position;
+			});
+
+		u64 readStart{}, readEnd{};
+
+		const auto pushRead{ [&](u32 firstEntry, u32 nbEntries)
+		{
+			plan.reads.push_back({ readStart, readEnd - readStart, firstEntry, nbEntries });
+			plan.maxReadSize = std::max(plan.maxReadSize, readEnd - readStart);
+		}};
+
+		u32 firstEntry{};
+
+		for (u32 i{}; i < plan.order.size(); ++i)
+		{
+			const auto& fileInfo{ filesInfo[plan.order[i]] };
+			const auto position{ static_cast<u64>(fileInfo.position) * Archive::sectorSize };
+			const auto start{ alignDown(position, alignment) };
+			const auto end{ alignUp(position + fileInfo.size, alignment) };
+
+			if (i != firstEntry)
+			{
+				// Large entries still get a single read, only merging is bounded by maxReadSize
+				if (start <= readEnd + maxGap && std::max(end, readEnd) - readStart <= maxReadSize)
+				{
+					readEnd = std::max(end, readEnd);
+					continue;
+				}
+
+				pushRead(firstEntry, i - firstEntry);
+				firstEntry = i;
+			}
+
+			readStart = start;
+			readEnd = end;
+		}
+
+		if (firstEntry != plan.order.size())
+		{
+			pushRead(firstEntry, static_cast<u32>(plan.order.size()) - firstEntry);
+		}
+
+		return plan;
+	}
+}
\ No newline at end of file
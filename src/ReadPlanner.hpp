@@ -0,0 +1,34 @@
+#pragma once
+
+#include "Archive.hpp"
+#include "Types.hpp"
+
+#include <span>
+#include <vector>
+
+namespace ReadPlanner
+{
+	inline constexpr auto
+		defaultMaxReadSize{ 8u * 1024 * 1024 },
+		defaultMaxGap{ 64u * 1024 };
+
+	struct Read
+	{
+		u64 position;
+		u64 size;
+		u32 firstEntry;
+		u32 nbEntries;
+	};
+
+	struct Plan
+	{
+		// Entries sorted by position, each read covers order[firstEntry, firstEntry + nbEntries)
+		std::vector<u32> order;
+		std::vector<Read> reads;
+		u64 maxReadSize;
+	};
+
+	// Reads are aligned to alignment so a plan can be used as is with direct I/O
+	Plan plan(std::span<const Archive::CdDataLocFileInfo> filesInfo, u64 alignment,
+		u64 maxReadSize = defaultMaxReadSize, u64 maxGap = defaultMaxGap);
+}
\ No newline at end of file
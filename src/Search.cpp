@@ -0,0 +1,217 @@
+#include "Search.hpp"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <bit>
+#include <cctype>
+#include <cstring>
+#include <optional>
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace Search
+{
+	// Code points of a UTF-8 string
+	static std::vector<u32> decodeUtf8(std::string_view text)
+	{
+		std::vector<u32> codePoints;
+
+		for (std::size_t i{}; i < text.size();)
+		{
+			const auto byte{ static_cast<u8>(text[i]) };
+			const auto length{ byte < 0x80 ? 1 : byte >= 0xF0 ? 4 : byte >= 0xE0 ? 3 : byte >= 0xC0 ? 2 : 0 };
+
+			if (length == 0 || i + length > text.size())
+			{
+				throw std::runtime_error{ fmt::format("\"{}\" is not valid UTF-8", text) };
+			}
+
+			u32 codePoint{ length == 1 ? byte : byte & (0x7Fu >> length) };
+			for (auto j{ 1 }; j < length; ++j)
+			{
+				codePoint = codePoint << 6 | (static_cast<u8>(text[i + j]) & 0x3F);
+			}
+
+			codePoints.push_back(codePoint);
+			i += length;
+		}
+
+		return codePoints;
+	}
+
+	// Shift-JIS ranges that map linearly to Unicode: kana, full width alphanumerics, ideographic space
+	static std::optional<u16> shiftJis(u32 codePoint)
+	{
+		struct Range
+		{
+			u32 first;
+			u32 last;
+			u16 code;
+		};
+
+		static constexpr Range ranges[]
+		{
+			{ 0x3000, 0x3000, 0x8140 },
+			{ 0x3041, 0x3093, 0x829F },
+			{ 0x30A1, 0x30DF, 0x8340 },
+			{ 0x30E0, 0x30F6, 0x8380 },
+			{ 0xFF10, 0xFF19, 0x824F },
+			{ 0xFF21, 0xFF3A, 0x8260 },
+			{ 0xFF41, 0xFF5A, 0x8281 },
+			{ 0xFF61, 0xFF9F, 0x00A1 }
+		};
+
+		for (const auto& range : ranges)
+		{
+			if (codePoint >= range.first && codePoint <= range.last)
+			{
+				return static_cast<u16>(range.code + codePoint - range.first);
+			}
+		}
+
+		return std::nullopt;
+	}
+
+	Pattern text(std::string_view text, Encoding encoding)
+	{
+		static constexpr const char* encodingNames[]{ "ASCII", "UTF-16", "Shift-JIS" };
+
+		Pattern pattern{ {}, fmt::format("\"{}\" {}", text, encodingNames[static_cast<int>(encoding)]) };
+
+		for (const auto codePoint : decodeUtf8(text))
+		{
+			if (encoding == Encoding::Utf16)
+			{
+				// Little endian, with surrogate pairs past the basic plane
+				const auto write{ [&](u32 unit) { pattern.bytes.insert(pattern.bytes.end(), { static_cast<u8>(unit), static_cast<u8>(unit >> 8) }); } };
+
+				if (codePoint >= 0x10000)
+				{
+					write(0xD800 + ((codePoint - 0x10000) >> 10));
+					write(0xDC00 + ((codePoint - 0x10000) & 0x3FF));
+				}
+				else
+				{
+					write(codePoint);
+				}
+			}
+			else if (codePoint < 0x80)
+			{
+				pattern.bytes.push_back(static_cast<u8>(codePoint));
+			}
+			else if (const auto code{ encoding == Encoding::ShiftJis ? shiftJis(codePoint) : std::nullopt })
+			{
+				if (*code > 0xFF)
+				{
+					pattern.bytes.push_back(static_cast<u8>(*code >> 8));
+				}
+				pattern.bytes.push_back(static_cast<u8>(*code));
+			}
+			else
+			{
+				throw std::runtime_error{ fmt::format("\"{}\" can't be encoded in {}", text, encodingNames[static_cast<int>(encoding)]) };
+			}
+		}
+
+		if (pattern.bytes.empty())
+		{
+			throw std::runtime_error{ "Empty search pattern" };
+		}
+
+		return pattern;
+	}
+
+	Pattern hex(std::string_view hex)
+	{
+		Pattern pattern{ {}, fmt::format("{} hex", hex) };
+		std::string digits;
+
+		for (const auto c : hex)
+		{
+			if (std::isxdigit(static_cast<unsigned char>(c)))
+			{
+				digits += c;
+			}
+			else if (c != ' ' && c != ':' && c != '-')
+			{
+				throw std::runtime_error{ fmt::format("\"{}\" is not a hexadecimal byte string", hex) };
+			}
+		}
+
+		if (digits.empty() || digits.size() % 2)
+		{
+			throw std::runtime_error{ fmt::format("\"{}\" is not a hexadecimal byte string", hex) };
+		}
+
+		for (std::size_t i{}; i < digits.size(); i += 2)
+		{
+			pattern.bytes.push_back(static_cast<u8>(std::stoul(digits.substr(i, 2), nullptr, 16)));
+		}
+
+		return pattern;
+	}
+
+	std::vector<Match> find(std::span<const u8> data, std::span<const Pattern> patterns)
+	{
+		std::vector<Match> matches;
+
+		const auto verify{ [&](std::size_t offset, u32 patternIndex)
+		{
+			const auto& bytes{ patterns[patternIndex].bytes };
+
+			if (offset + bytes.size() <= data.size() && std::memcmp(data.data() + offset, bytes.data(), bytes.size()) == 0)
+			{
+				matches.push_back({ offset, patternIndex });
+			}
+		}};
+
+		std::size_t offset{};
+
+#ifdef __SSE2__
+		// Candidates are positions where both the first and the last byte of a pattern match, 16 positions per compare
+		std::size_t maxSize{};
+		for (const auto& pattern : patterns)
+		{
+			maxSize = std::max(maxSize, pattern.bytes.size());
+		}
+
+		for (; offset + maxSize + 15 <= data.size(); offset += 16)
+		{
+			for (u32 p{}; p < patterns.size(); ++p)
+			{
+				const auto& bytes{ patterns[p].bytes };
+				const auto first{ _mm_set1_epi8(static_cast<char>(bytes.front())) };
+				const auto last{ _mm_set1_epi8(static_cast<char>(bytes.back())) };
+				const auto firstBlock{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(data.data() + offset)) };
+				const auto lastBlock{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(data.data() + offset + bytes.size() - 1)) };
+
+				auto mask{ static_cast<u32>(_mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(firstBlock, first), _mm_cmpeq_epi8(lastBlock, last)))) };
+
+				while (mask)
+				{
+					verify(offset + std::countr_zero(mask), p);
+					mask &= mask - 1;
+				}
+			}
+		}
+#endif
+		for (; offset < data.size(); ++offset)
+		{
+			for (u32 p{}; p < patterns.size(); ++p)
+			{
+				if (data[offset] == patterns[p].bytes.front())
+				{
+					verify(offset, p);
+				}
+			}
+		}
+
+		// Blocks are scanned pattern by pattern
+		std::stable_sort(matches.begin(), matches.end(), [](const Match& lhs, const Match& rhs) { return lhs.offset < rhs.offset; });
+		return matches;
+	}
+}
\ No newline at end of file
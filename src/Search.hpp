@@ -0,0 +1,39 @@
+#pragma once
+
+#include "Types.hpp"
+
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Byte patterns searched in entries of CDDATA.000
+namespace Search
+{
+	enum class Encoding
+	{
+		Ascii,
+		Utf16,
+		ShiftJis
+	};
+
+	struct Pattern
+	{
+		std::vector<u8> bytes;
+		// Text and encoding, for reports
+		std::string label;
+	};
+
+	// Text given as UTF-8 encoded as asked, hex is a byte string like "54 49 4D 32"
+	Pattern text(std::string_view text, Encoding encoding);
+	Pattern hex(std::string_view hex);
+
+	struct Match
+	{
+		u64 offset;
+		u32 pattern;
+	};
+
+	// Matches of every pattern sorted by offset, overlapping ones included
+	std::vector<Match> find(std::span<const u8> data, std::span<const Pattern> patterns);
+}
\ No newline at end of file
@@ -0,0 +1,77 @@
+#include "SectorIndex.hpp"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+
+SectorIndex::SectorIndex(std::span<const Archive::CdDataLocFileInfo> filesInfo)
+{
+	std::vector<u32> order(filesInfo.size());
+	std::iota(order.begin(), order.end(), 0u);
+	std::stable_sort(order.begin(), order.end(), [&](u32 lhs, u32 rhs) { return filesInfo[lhs].position < filesInfo[rhs].position; });
+
+	for (const auto index : order)
+	{
+		const auto& fileInfo{ filesInfo[index] };
+
+		// Empty entries share the position of the next one and hold no sector
+		if (fileInfo.nbSectors)
+		{
+			m_starts.push_back(fileInfo.position);
+			m_ends.push_back(fileInfo.position + fileInfo.nbSectors);
+			m_entries.push_back(index);
+		}
+	}
+}
+
+std::optional<u32> SectorIndex::find(u32 sector) const
+{
+	const auto i{ lowerBound(sector) };
+
+	if (i < m_starts.size() && m_starts[i] <= sector)
+	{
+		return m_entries[i];
+	}
+
+	return std::nullopt;
+}
+
+std::optional<SectorIndex::Location> SectorIndex::locate(u64 offset) const
+{
+	const auto sector{ offset / Archive::sectorSize };
+
+	if (sector > std::numeric_limits<u32>::max())
+	{
+		return std::nullopt;
+	}
+
+	const auto i{ lowerBound(static_cast<u32>(sector)) };
+
+	if (i < m_starts.size() && m_starts[i] <= sector)
+	{
+		return Location{ m_entries[i], offset - static_cast<u64>(m_starts[i]) * Archive::sectorSize };
+	}
+
+	return std::nullopt;
+}
+
+std::size_t SectorIndex::lowerBound(u32 sector) const
+{
+	if (m_ends.empty())
+	{
+		return 0;
+	}
+
+	// Branchless upper bound, the halving depends only on the size so the select compiles to a cmov
+	const auto* base{ m_ends.data() };
+	auto size{ m_ends.size() };
+
+	while (size > 1)
+	{
+		const auto half{ size / 2 };
+		base = base[half] <= sector ? base + half : base;
+		size -= half;
+	}
+
+	return static_cast<std::size_t>(base - m_ends.data()) + (*base <= sector);
+}
\ No newline at end of file
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "Archive.hpp"
+#include "Types.hpp"
+
+#include <algorithm>
+#include <optional>
+#include <span>
+#include <vector>
+
+// Entries sorted by first sector, maps sectors of CDDATA.000 back to LOC indices
+class SectorIndex
+{
+public:
+	struct Location
+	{
+		u32 index;
+		// From the start of the entry, past its size for the padding of its last sector
+		u64 offset;
+	};
+
+	explicit SectorIndex(std::span<const Archive::CdDataLocFileInfo> filesInfo);
+
+	// Entry holding the sector, none for gaps and sectors past the last entry
+	std::optional<u32> find(u32 sector) const;
+	// Entry holding the byte of CDDATA.000
+	std::optional<Location> locate(u64 offset) const;
+
+	// Calls function(index, nbSectors) for every entry overlapping [sector, sector + nbSectors) in position order
+	template <typename Function>
+	void forEach(u32 sector, u32 nbSectors, Function&& function) const
+	{
+		const auto end{ static_cast<u64>(sector) + nbSectors };
+
+		for (auto i{ lowerBound(sector) }; i < m_starts.size() && m_starts[i] < end; ++i)
+		{
+			const auto overlapStart{ std::max<u64>(m_starts[i], sector) };
+			const auto overlapEnd{ std::min<u64>(m_ends[i], end) };
+
+			if (overlapStart < overlapEnd)
+			{
+				function(m_entries[i], static_cast<u32>(overlapEnd - overlapStart));
+			}
+		}
+	}
+private:
+	// First entry ending after sector
+	std::size_t lowerBound(u32 sector) const;
+
+	std::vector<u32> m_starts;
+	std::vector<u32> m_ends;
+	std::vector<u32> m_entries;
+};
\ No newline at end of file
@@ -0,0 +1,108 @@
+#include "Store.hpp"
+
+#include "File.hpp"
+
+#include "fmt/format.h"
+
+#include <random>
+#include <system_error>
+
+static constexpr auto objectsDirectory{ "objects" };
+
+Store::Store(const std::filesystem::path& path)
+	: m_path{ path }, m_tempId{ std::random_device{}() }, m_nbTemps{}, m_reflinks{ true }, m_hardlinks{ true },
+	m_nbObjectsWritten{}, m_objectsWrittenSize{}, m_nbLinks{}
+{
+	// Every fan out directory exists before objects are added from several threads
+	for (u32 i{}; i < 256; ++i)
+	{
+		std::filesystem::create_directories(fmt::format("{}/{}/{:02x}", m_path.string(), objectsDirectory, i));
+	}
+}
+
+std::filesystem::path Store::objectPath(const Hash::Sha256& hash) const
+{
+	return fmt::format("{}/{}/{:02x}/{:02x}", m_path.string(), objectsDirectory, hash[0], fmt::join(hash, ""));
+}
+
+Store::Link Store::add(std::span<const char> data, const std::filesystem::path& path)
+{
+	const auto object{ objectPath(Hash::sha256(data.data(), data.size())) };
+
+	// Objects appear whole under their name, written to a unique temporary file then renamed
+	if (!std::filesystem::exists(object))
+	{
+		const std::filesystem::path temp{ fmt::format("{}.{:x}.{}.tmp", object.string(), m_tempId, m_nbTemps++) };
+		{
+			File file{ temp, File::Mode::Write };
+			file.writeSparse(0, data.data(), data.size());
+		}
+
+		// Hard links share permissions with the tree files, read only objects can't be edited through them
+		std::filesystem::permissions(temp, std::filesystem::perms::owner_read | std::filesystem::perms::group_read |
+			std::filesystem::perms::others_read);
+		std::filesystem::rename(temp, object);
+
+		++m_nbObjectsWritten;
+		m_objectsWrittenSize += data.size();
+	}
+
+	std::filesystem::remove(path);
+
+	auto link{ Link::Copy };
+	std::error_code error;
+
+	if (m_reflinks)
+	{
+		File src{ object, File::Mode::Read };
+		File dest{ path, File::Mode::Write };
+
+		if (dest.clone(src))
+		{
+			link = Link::Reflink;
+		}
+		else
+		{
+			m_reflinks = false;
+		}
+	}
+
+	if (link == Link::Copy && m_hardlinks)
+	{
+		std::filesystem::remove(path);
+		std::filesystem::create_hard_link(object, path, error);
+
+		if (!error)
+		{
+			link = Link::Hardlink;
+		}
+		else
+		{
+			m_hardlinks = false;
+		}
+	}
+
+	if (link == Link::Copy)
+	{
+		File file{ path, File::Mode::Write };
+		file.writeSparse(0, data.data(), data.size());
+	}
+
+	++m_nbLinks[static_cast<int>(link)];
+	return link;
+}
+
+u32 Store::nbObjectsWritten() const
+{
+	return m_nbObjectsWritten;
+}
+
+u64 Store::objectsWrittenSize() const
+{
+	return m_objectsWrittenSize;
+}
+
+u32 Store::nbLinks(Link link) const
+{
+	return m_nbLinks[static_cast<int>(link)];
+}
\ No newline at end of file
@@ -0,0 +1,40 @@
+#pragma once
+
+#include "Hash.hpp"
+#include "Types.hpp"
+
+#include <atomic>
+#include <filesystem>
+#include <span>
+
+// Content addressed store of unpacked files shared by the trees of several dumps, objects are named
+// by the SHA-256 of their content ("objects/ab/ab12...") and tree files are links to them
+class Store
+{
+public:
+	enum class Link
+	{
+		Reflink,
+		Hardlink,
+		Copy
+	};
+
+	explicit Store(const std::filesystem::path& path);
+
+	std::filesystem::path objectPath(const Hash::Sha256& hash) const;
+	// Writes the object of data when it's missing and replaces path by a link to it, safe from several threads
+	Link add(std::span<const char> data, const std::filesystem::path& path);
+
+	u32 nbObjectsWritten() const;
+	u64 objectsWrittenSize() const;
+	u32 nbLinks(Link link) const;
+private:
+	std::filesystem::path m_path;
+	u64 m_tempId;
+	std::atomic<u64> m_nbTemps;
+	// Link kinds the filesystem refused aren't tried again
+	std::atomic<bool> m_reflinks, m_hardlinks;
+	std::atomic<u32> m_nbObjectsWritten;
+	std::atomic<u64> m_objectsWrittenSize;
+	std::atomic<u32> m_nbLinks[3];
+};
\ No newline at end of file
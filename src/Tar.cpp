@@ -0,0 +1,252 @@
+#include "Tar.hpp"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+
+namespace Tar
+{
+	struct Header
+	{
+		char name[100];
+		char mode[8];
+		char uid[8];
+		char gid[8];
+		char size[12];
+		char mtime[12];
+		char checksum[8];
+		char type;
+		char linkName[100];
+		char magic[6];
+		char version[2];
+		char userName[32];
+		char groupName[32];
+		char deviceMajor[8];
+		char deviceMinor[8];
+		char prefix[155];
+		char pad[12];
+	};
+
+	static_assert(sizeof(Header) == blockSize);
+
+	template <std::size_t Size>
+	static void writeOctal(char(&field)[Size], u64 value)
+	{
+		fmt::format_to_n(field, Size - 1, "{:0{}o}", value, Size - 1);
+		field[Size - 1] = '\0';
+	}
+
+	template <std::size_t Size>
+	static u64 readNumber(const char(&field)[Size])
+	{
+		// GNU base-256 encoding for values that don't fit in octal
+		if (static_cast<u8>(field[0]) & 0x80)
+		{
+			u64 value{ static_cast<u8>(field[0]) & 0x7Fu };
+			for (std::size_t i{ 1 }; i < Size; ++i)
+			{
+				value = value << 8 | static_cast<u8>(field[i]);
+			}
+			return value;
+		}
+
+		u64 value{};
+		for (std::size_t i{}; i < Size && field[i] >= '0' && field[i] <= '7'; ++i)
+		{
+			value = value << 3 | static_cast<u64>(field[i] - '0');
+		}
+		return value;
+	}
+
+	static u32 checksum(const Header& header)
+	{
+		const auto* const bytes{ reinterpret_cast<const u8*>(&header) };
+		u32 sum{};
+
+		for (std::size_t i{}; i < blockSize; ++i)
+		{
+			const auto isChecksumField{ i >= offsetof(Header, checksum) && i < offsetof(Header, checksum) + sizeof(header.checksum) };
+			sum += isChecksumField ? ' ' : bytes[i];
+		}
+
+		return sum;
+	}
+
+	template <std::size_t Size>
+	static std::string_view field(const char(&field)[Size])
+	{
+		return { field, static_cast<std::size_t>(std::find(field, field + Size, '\0') - field) };
+	}
+
+	void header(char* block, std::string_view path, u64 size, s64 mtime, char type)
+	{
+		auto* const header{ reinterpret_cast<Header*>(block) };
+		std::memset(header, 0, sizeof(Header));
+
+		auto name{ path }, prefix{ std::string_view{} };
+
+		if (name.size() > sizeof(header->name))
+		{
+			// ustar splits long paths on a separator, the name keeps the last components
+			const auto separator{ path.find('/', path.size() - sizeof(header->name) - 1) };
+
+			if (separator == std::string_view::npos || separator > sizeof(header->prefix))
+			{
+				throw std::runtime_error{ fmt::format("\"{}\" is too long for a tar header", path) };
+			}
+
+			prefix = path.substr(0, separator);
+			name = path.substr(separator + 1);
+		}
+
+		std::memcpy(header->name, name.data(), name.size());
+		std::memcpy(header->prefix, prefix.data(), prefix.size());
+		writeOctal(header->mode, type == directoryType ? 0755 : 0644);
+		writeOctal(header->uid, 0);
+		writeOctal(header->gid, 0);
+		writeOctal(header->size, size);
+		writeOctal(header->mtime, static_cast<u64>(std::max<s64>(mtime, 0)));
+		header->type = type;
+		std::memcpy(header->magic, "ustar", 6);
+		std::memcpy(header->version, "00", 2);
+
+		fmt::format_to_n(header->checksum, sizeof(header->checksum), "{:06o}", checksum(*header));
+		header->checksum[6] = '\0';
+		header->checksum[7] = ' ';
+	}
+
+	Reader::Reader(File& file)
+		: m_file{ file }, m_position{}, m_remaining{}, m_padding{}
+	{
+	}
+
+	bool Reader::next(Entry& entry)
+	{
+		skip(m_remaining + m_padding);
+
+		std::string longPath;
+		Header header;
+
+		while (true)
+		{
+			if (m_file.read(m_position, &header, blockSize) != blockSize)
+			{
+				throw std::runtime_error{ "Tar stream is truncated" };
+			}
+			m_position += blockSize;
+
+			const auto* const bytes{ reinterpret_cast<const char*>(&header) };
+			if (std::all_of(bytes, bytes + blockSize, [](char c) { return c == '\0'; }))
+			{
+				return false;
+			}
+
+			if (readNumber(header.checksum) != checksum(header))
+			{
+				throw std::runtime_error{ "Tar stream has an invalid header checksum" };
+			}
+
+			const auto size{ readNumber(header.size) };
+			m_remaining = size;
+			m_padding = padding(size);
+
+			// GNU long names and pax path records override the name of the next entry
+			if (header.type == 'L' || header.type == 'x')
+			{
+				std::string data(static_cast<std::size_t>(size), '\0');
+				read(data.data(), data.size());
+				skip(m_padding);
+
+				if (header.type == 'L')
+				{
+					longPath = data.c_str();
+					continue;
+				}
+
+				for (std::size_t recordStart{}; recordStart < data.size();)
+				{
+					const auto space{ data.find(' ', recordStart) };
+					const auto length{ std::strtoull(data.c_str() + recordStart, nullptr, 10) };
+
+					if (space == std::string::npos || !length || recordStart + length > data.size())
+					{
+						throw std::runtime_error{ "Tar stream has an invalid pax header" };
+					}
+
+					const std::string_view record{ data.data() + space + 1, recordStart + length - space - 2 };
+
+					if (record.starts_with("path="))
+					{
+						longPath = record.substr(5);
+					}
+
+					recordStart += length;
+				}
+				continue;
+			}
+			else if (header.type == 'g')
+			{
+				skip(m_remaining + m_padding);
+				continue;
+			}
+
+			if (!longPath.empty())
+			{
+				entry.path = std::move(longPath);
+			}
+			else if (header.prefix[0])
+			{
+				entry.path = fmt::format("{}/{}", field(header.prefix), field(header.name));
+			}
+			else
+			{
+				entry.path = field(header.name);
+			}
+
+			entry.size = size;
+			entry.type = header.type == '\0' ? regularType : header.type;
+			return true;
+		}
+	}
+
+	void Reader::read(char* data, std::size_t size)
+	{
+		if (size > m_remaining || m_file.read(m_position, data, size) != size)
+		{
+			throw std::runtime_error{ "Tar stream is truncated" };
+		}
+
+		m_position += size;
+		m_remaining -= size;
+	}
+
+	void Reader::skip(u64 size)
+	{
+		std::array<char, 64 * blockSize> buffer;
+
+		if (m_file.isSeekable())
+		{
+			m_position += size;
+			size = 0;
+		}
+
+		while (size)
+		{
+			const auto toSkip{ static_cast<std::size_t>(std::min<u64>(size, buffer.size())) };
+
+			if (m_file.read(m_position, buffer.data(), toSkip) != toSkip)
+			{
+				throw std::runtime_error{ "Tar stream is truncated" };
+			}
+
+			m_position += toSkip;
+			size -= toSkip;
+		}
+
+		m_remaining = 0;
+		m_padding = 0;
+	}
+}
\ No newline at end of file
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "File.hpp"
+#include "Types.hpp"
+
+#include <string>
+#include <string_view>
+
+// POSIX ustar streams
+namespace Tar
+{
+	inline constexpr auto blockSize{ 512u };
+
+	inline constexpr char
+		regularType{ '0' },
+		directoryType{ '5' };
+
+	struct Entry
+	{
+		std::string path;
+		u64 size;
+		char type;
+	};
+
+	void header(char* block, std::string_view path, u64 size, s64 mtime, char type);
+
+	constexpr u64 padding(u64 size)
+	{
+		return (blockSize - size % blockSize) % blockSize;
+	}
+
+	class Reader
+	{
+	public:
+		explicit Reader(File& file);
+
+		// Returns false at the end of the archive, data of the previous entry not read is skipped
+		bool next(Entry& entry);
+		void read(char* data, std::size_t size);
+	private:
+		void skip(u64 size);
+
+		File& m_file;
+		u64 m_position;
+		u64 m_remaining;
+		u64 m_padding;
+	};
+}
\ No newline at end of file
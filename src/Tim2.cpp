@@ -0,0 +1,322 @@
+#include "Tim2.hpp"
+
+#include "Palette.hpp"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace Tim2
+{
+	static u32 bitsPerPixel(u8 colorType)
+	{
+		switch (colorType)
+		{
+		case Rgba16:
+			return 16;
+		case Rgb24:
+			return 24;
+		case Rgba32:
+			return 32;
+		case Indexed4:
+			return 4;
+		case Indexed8:
+			return 8;
+		default:
+			return 0;
+		}
+	}
+
+	bool isTim2(std::span<const char> data)
+	{
+		return data.size() >= sizeof(FileHeader) && std::equal(magic.begin(), magic.end(), data.begin());
+	}
+
+	std::vector<Picture> pictures(std::span<const char> data)
+	{
+		if (!isTim2(data))
+		{
+			throw std::runtime_error{ "TIM2 is invalid" };
+		}
+
+		FileHeader fileHeader;
+		std::memcpy(&fileHeader, data.data(), sizeof(fileHeader));
+
+		std::vector<Picture> pictures;
+		u64 offset{ fileHeader.format == 1 ? 128u : sizeof(FileHeader) };
+
+		for (u32 i{}; i < fileHeader.nbPictures; ++i)
+		{
+			if (offset + sizeof(PictureHeader) > data.size())
+			{
+				throw std::runtime_error{ "TIM2 is invalid" };
+			}
+
+			auto& picture{ pictures.emplace_back() };
+			std::memcpy(&picture.header, data.data() + offset, sizeof(PictureHeader));
+
+			const auto& header{ picture.header };
+			const auto imageOffset{ offset + header.headerSize }, clutOffset{ imageOffset + header.imageSize };
+
+			if (header.headerSize < sizeof(PictureHeader) || clutOffset + header.clutSize > data.size() ||
+				header.totalSize < header.headerSize + static_cast<u64>(header.imageSize) + header.clutSize)
+			{
+				throw std::runtime_error{ "TIM2 is invalid" };
+			}
+
+			picture.headerOffset = static_cast<u32>(offset);
+			picture.imageOffset = static_cast<u32>(imageOffset);
+			picture.clutOffset = static_cast<u32>(clutOffset);
+			offset += header.totalSize;
+		}
+
+		return pictures;
+	}
+
+	bool isSupported(const PictureHeader& header)
+	{
+		const auto imageBits{ bitsPerPixel(header.imageType) };
+
+		if (imageBits == 0 || (static_cast<u64>(header.width) * header.height * imageBits + 7) / 8 > header.imageSize)
+		{
+			return false;
+		}
+		else if (header.imageType == Indexed4 || header.imageType == Indexed8)
+		{
+			const auto clutBits{ bitsPerPixel(header.clutType & 0x3F) };
+			return clutBits >= 16 && clutBits <= 32 && static_cast<u64>(header.nbClutColors) * clutBits / 8 <= header.clutSize;
+		}
+
+		return true;
+	}
+
+	// Direct colors to RGBA, alpha doubled with saturation so that 0x80 becomes 0xFF
+	static void convertColors(const u8* src, u8 colorType, std::size_t nbColors, u8* dest)
+	{
+		std::size_t i{};
+
+		switch (colorType)
+		{
+		case Rgba32:
+#ifdef __SSE2__
+			for (const auto alphaMask{ _mm_set1_epi32(static_cast<int>(0xFF000000)) }; i + 4 <= nbColors; i += 4)
+			{
+				const auto colors{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i * 4)) };
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i * 4), _mm_adds_epu8(colors, _mm_and_si128(colors, alphaMask)));
+			}
+#endif
+			for (; i < nbColors; ++i)
+			{
+				std::memcpy(dest + i * 4, src + i * 4, 3);
+				dest[i * 4 + 3] = static_cast<u8>(std::min(src[i * 4 + 3] * 2, 0xFF));
+			}
+			break;
+		case Rgb24:
+			for (; i < nbColors; ++i)
+			{
+				std::memcpy(dest + i * 4, src + i * 3, 3);
+				dest[i * 4 + 3] = 0xFF;
+			}
+			break;
+		case Rgba16:
+			for (; i < nbColors; ++i)
+			{
+				const auto color{ static_cast<u32>(src[i * 2] | src[i * 2 + 1] << 8) };
+				for (u32 channel{}; channel < 3; ++channel)
+				{
+					const auto value{ color >> channel * 5 & 0x1F };
+					dest[i * 4 + channel] = static_cast<u8>(value << 3 | value >> 2);
+				}
+				dest[i * 4 + 3] = color & 0x8000 ? 0xFF : 0;
+			}
+			break;
+		}
+	}
+
+	// 4-bit indices to one byte per pixel, low nibble first
+	static void expandNibbles(const u8* src, std::size_t nbPixels, u8* dest)
+	{
+		std::size_t i{};
+
+#ifdef __SSE2__
+		const auto lowMask{ _mm_set1_epi8(0x0F) };
+
+		for (; i + 32 <= nbPixels; i += 32)
+		{
+			const auto bytes{ _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i / 2)) };
+			const auto low{ _mm_and_si128(bytes, lowMask) };
+			const auto high{ _mm_and_si128(_mm_srli_epi16(bytes, 4), lowMask) };
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i), _mm_unpacklo_epi8(low, high));
+			_mm_storeu_si128(reinterpret_cast<__m128i*>(dest + i + 16), _mm_unpackhi_epi8(low, high));
+		}
+#endif
+		for (; i < nbPixels; ++i)
+		{
+			dest[i] = src[i / 2] >> (i % 2 * 4) & 0x0F;
+		}
+	}
+
+	std::vector<u8> decode(std::span<const char> data, const Picture& picture)
+	{
+		const auto& header{ picture.header };
+
+		if (!isSupported(header))
+		{
+			throw std::runtime_error{ fmt::format("TIM2 image type {} with CLUT type {} is not supported", header.imageType, header.clutType) };
+		}
+
+		const std::size_t nbPixels{ static_cast<std::size_t>(header.width) * header.height };
+		const auto* const image{ reinterpret_cast<const u8*>(data.data()) + picture.imageOffset };
+		std::vector<u8> pixels(nbPixels * 4);
+
+		if (header.imageType != Indexed4 && header.imageType != Indexed8)
+		{
+			convertColors(image, header.imageType, nbPixels, pixels.data());
+			return pixels;
+		}
+
+		// Palette in index order, indices past the CLUT are transparent black
+		const auto nbColors{ std::min<std::size_t>(header.nbClutColors, header.imageType == Indexed4 ? 16 : 256) };
+		std::array<u8, 256 * 4> clut{};
+		convertColors(reinterpret_cast<const u8*>(data.data()) + picture.clutOffset, header.clutType & 0x3F, nbColors, clut.data());
+
+		std::array<u32, 256> palette{};
+		for (u32 i{}; i < nbColors; ++i)
+		{
+			std::memcpy(&palette[clutIndex(i, header)], clut.data() + i * 4, 4);
+		}
+
+		std::vector<u8> indices;
+		const auto* pixelIndices{ image };
+
+		if (header.imageType == Indexed4)
+		{
+			indices.resize(nbPixels);
+			expandNibbles(image, nbPixels, indices.data());
+			pixelIndices = indices.data();
+		}
+
+		for (std::size_t i{}; i < nbPixels; ++i)
+		{
+			std::memcpy(pixels.data() + i * 4, &palette[pixelIndices[i]], 4);
+		}
+
+		return pixels;
+	}
+
+	// Inverse of convertColors, colors equal to the reference are left untouched so that lossy formats round-trip
+	static void convertColorsBack(const u8* src, const u8* reference, u8 colorType, std::size_t nbColors, u8* dest)
+	{
+		for (std::size_t i{}; i < nbColors; ++i)
+		{
+			const auto* const color{ src + i * 4 };
+
+			if (std::equal(color, color + 4, reference + i * 4))
+			{
+				continue;
+			}
+
+			switch (colorType)
+			{
+			case Rgba32:
+				std::memcpy(dest + i * 4, color, 3);
+				dest[i * 4 + 3] = static_cast<u8>((color[3] + 1) / 2);
+				break;
+			case Rgb24:
+				std::memcpy(dest + i * 3, color, 3);
+				break;
+			case Rgba16:
+			{
+				const auto value{ static_cast<u32>(color[0] >> 3 | color[1] >> 3 << 5 | color[2] >> 3 << 10 | (color[3] >= 0x80 ? 0x8000 : 0)) };
+				dest[i * 2] = static_cast<u8>(value);
+				dest[i * 2 + 1] = static_cast<u8>(value >> 8);
+				break;
+			}
+			}
+		}
+	}
+
+	void encode(std::span<char> data, const Picture& picture, std::span<const u8> pixels)
+	{
+		const auto& header{ picture.header };
+		const std::size_t nbPixels{ static_cast<std::size_t>(header.width) * header.height };
+
+		if (!isSupported(header))
+		{
+			throw std::runtime_error{ fmt::format("TIM2 image type {} with CLUT type {} is not supported", header.imageType, header.clutType) };
+		}
+		else if (pixels.size() != nbPixels * 4)
+		{
+			throw std::runtime_error{ fmt::format("Image must be {}x{}", header.width, header.height) };
+		}
+
+		const auto reference{ decode(data, picture) };
+		auto* const image{ reinterpret_cast<u8*>(data.data()) + picture.imageOffset };
+
+		if (header.imageType != Indexed4 && header.imageType != Indexed8)
+		{
+			convertColorsBack(pixels.data(), reference.data(), header.imageType, nbPixels, image);
+			return;
+		}
+
+		// Palette and indices in CLUT order, a CSM1 CLUT of less than 256 colors doesn't fill
+		// the first entries of the index order so quantizing in it would use colors that aren't stored
+		const auto nbColors{ std::min<std::size_t>(header.nbClutColors, header.imageType == Indexed4 ? 16 : 256) };
+		const auto clutType{ static_cast<u8>(header.clutType & 0x3F) };
+		auto* const clut{ reinterpret_cast<u8*>(data.data()) + picture.clutOffset };
+
+		std::vector<u32> palette(nbColors);
+		convertColors(clut, clutType, nbColors, reinterpret_cast<u8*>(palette.data()));
+		const auto referencePalette{ palette };
+
+		std::vector<u8> referenceIndices(nbPixels);
+		if (header.imageType == Indexed4)
+		{
+			expandNibbles(image, nbPixels, referenceIndices.data());
+		}
+		else
+		{
+			std::memcpy(referenceIndices.data(), image, nbPixels);
+		}
+
+		// clutIndex() swaps blocks, it maps both ways
+		for (auto& index : referenceIndices)
+		{
+			index = static_cast<u8>(clutIndex(index, header));
+		}
+
+		std::vector<u32> colors(nbPixels), referenceColors(nbPixels);
+		std::memcpy(colors.data(), pixels.data(), pixels.size());
+		std::memcpy(referenceColors.data(), reference.data(), reference.size());
+
+		std::vector<u8> indices(nbPixels);
+		Palette::quantize(colors, referenceColors, referenceIndices, palette, indices);
+
+		convertColorsBack(reinterpret_cast<const u8*>(palette.data()), reinterpret_cast<const u8*>(referencePalette.data()), clutType, nbColors, clut);
+
+		for (auto& index : indices)
+		{
+			index = static_cast<u8>(clutIndex(index, header));
+		}
+
+		if (header.imageType == Indexed4)
+		{
+			// Never past the picture, the CLUT follows it
+			for (std::size_t i{}; i < nbPixels && i / 2 < header.imageSize; ++i)
+			{
+				auto& byte{ image[i / 2] };
+				byte = static_cast<u8>(i % 2 ? (byte & 0x0F) | indices[i] << 4 : (byte & 0xF0) | indices[i]);
+			}
+		}
+		else
+		{
+			std::memcpy(image, indices.data(), nbPixels);
+		}
+	}
+}
\ No newline at end of file
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "Types.hpp"
+
+#include <array>
+#include <span>
+#include <vector>
+
+// PS2 TIM2 textures
+namespace Tim2
+{
+	inline constexpr std::array<char, 4> magic{ 'T', 'I', 'M', '2' };
+
+	struct FileHeader
+	{
+		std::array<char, 4> magic;
+		u8 version;
+		// 0 for pictures aligned on 16 bytes, 1 on 128 bytes
+		u8 format;
+		u16 nbPictures;
+		std::array<u8, 8> reserved;
+	};
+
+	struct PictureHeader
+	{
+		u32 totalSize;
+		u32 clutSize;
+		u32 imageSize;
+		u16 headerSize;
+		u16 nbClutColors;
+		u8 pictureFormat;
+		u8 nbMipMaps;
+		// Color type in the low bits, bit 7 set for a linear (CSM2) CLUT
+		u8 clutType;
+		u8 imageType;
+		u16 width;
+		u16 height;
+		u64 gsTex0;
+		u64 gsTex1;
+		u32 gsRegs;
+		u32 gsTexClut;
+	};
+
+	static_assert(sizeof(FileHeader) == 16 && sizeof(PictureHeader) == 48);
+
+	enum ColorType : u8
+	{
+		Rgba16 = 1,
+		Rgb24,
+		Rgba32,
+		Indexed4,
+		Indexed8
+	};
+
+	struct Picture
+	{
+		PictureHeader header;
+		// Offsets in the file
+		u32 headerOffset;
+		u32 imageOffset;
+		u32 clutOffset;
+	};
+
+	bool isTim2(std::span<const char> data);
+	// Throws when the headers don't fit the file
+	std::vector<Picture> pictures(std::span<const char> data);
+	bool isSupported(const PictureHeader& header);
+
+	// Index of the color stored at position i of a CLUT, the PS2 stores 256 color CLUTs (CSM1) by blocks of 8 swapped two by two
+	constexpr u32 clutIndex(u32 i, const PictureHeader& header)
+	{
+		if ((header.clutType & 0x80) || header.imageType != Indexed8)
+		{
+			return i;
+		}
+
+		switch (i & 0x18)
+		{
+		case 0x08:
+			return i + 8;
+		case 0x10:
+			return i - 8;
+		default:
+			return i;
+		}
+	}
+
+	// Base level as 8-bit RGBA, PS2 alpha (0x80 is opaque) scaled to 0xFF
+	std::vector<u8> decode(std::span<const char> data, const Picture& picture);
+	// Replaces the base level of a picture in place with RGBA pixels, keeping its header, CLUT layout and size,
+	// indexed pictures are quantized to their CLUT and colors unchanged from decode() keep their bytes
+	void encode(std::span<char> data, const Picture& picture, std::span<const u8> pixels);
+}
\ No newline at end of file
@@ -0,0 +1,123 @@
+#include "Trace.hpp"
+
+#include "File.hpp"
+#include "SectorIndex.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <charconv>
+#include <cstring>
+#include <limits>
+#include <optional>
+
+namespace Trace
+{
+	// Numbers of a line in decimal or 0x hexadecimal, any other character separates them
+	static std::size_t parseLine(const char* begin, const char* end, std::array<u64, 3>& numbers)
+	{
+		std::size_t nbNumbers{};
+
+		while (begin < end && nbNumbers < numbers.size())
+		{
+			if (*begin < '0' || *begin > '9')
+			{
+				++begin;
+				continue;
+			}
+
+			auto base{ 10 };
+
+			if (*begin == '0' && end - begin > 2 && (begin[1] == 'x' || begin[1] == 'X'))
+			{
+				begin += 2;
+				base = 16;
+			}
+
+			const auto [ptr, error]{ std::from_chars(begin, end, numbers[nbNumbers], base) };
+
+			if (error == std::errc{})
+			{
+				++nbNumbers;
+			}
+
+			// Skips the rest of the token, like the fraction of a timestamp
+			begin = ptr;
+			while (begin < end && *begin != ' ' && *begin != '\t' && *begin != ',' && *begin != ';')
+			{
+				++begin;
+			}
+		}
+
+		return nbNumbers;
+	}
+
+	Report analyze(const std::filesystem::path& tracePath, std::span<const Archive::CdDataLocFileInfo> filesInfo, u32 baseLba)
+	{
+		const MappedFile trace{ tracePath };
+		const SectorIndex sectorIndex{ filesInfo };
+
+		Report report
+		{
+			.nbReads = std::vector<u32>(filesInfo.size()),
+			.nbSectorsRead = std::vector<u64>(filesInfo.size()),
+			.firstTouch = {},
+			.firstTimestamp = std::vector<u64>(filesInfo.size()),
+			.seekHistogram = {},
+			.nbTotalReads = 0,
+			.nbOutsideReads = 0
+		};
+
+		const auto* ptr{ trace.data() };
+		const auto* const end{ ptr + trace.size() };
+		std::array<u64, 3> numbers{};
+		std::optional<u64> previousEnd;
+
+		while (ptr < end)
+		{
+			const auto* lineEnd{ static_cast<const char*>(std::memchr(ptr, '\n', end - ptr)) };
+			lineEnd = lineEnd ? lineEnd : end;
+
+			const auto nbNumbers{ parseLine(ptr, lineEnd, numbers) };
+			ptr = lineEnd + 1;
+
+			if (nbNumbers < 2)
+			{
+				continue;
+			}
+
+			const auto [lba, count, timestamp]{ numbers };
+			++report.nbTotalReads;
+
+			// Distance from the end of the previous read, the head stays there
+			if (previousEnd)
+			{
+				const auto distance{ lba > *previousEnd ? lba - *previousEnd : *previousEnd - lba };
+				++report.seekHistogram[std::min<std::size_t>(std::bit_width(distance), nbSeekBuckets - 1)];
+			}
+			previousEnd = lba + count;
+
+			if (lba < baseLba || lba - baseLba > std::numeric_limits<u32>::max() || count > std::numeric_limits<u32>::max())
+			{
+				++report.nbOutsideReads;
+				continue;
+			}
+
+			bool inside{};
+
+			sectorIndex.forEach(static_cast<u32>(lba - baseLba), static_cast<u32>(count), [&](u32 index, u32 nbSectors)
+			{
+				if (report.nbReads[index]++ == 0)
+				{
+					report.firstTouch.push_back(index);
+					report.firstTimestamp[index] = nbNumbers > 2 ? timestamp : 0;
+				}
+				report.nbSectorsRead[index] += nbSectors;
+				inside = true;
+			});
+
+			report.nbOutsideReads += !inside;
+		}
+
+		return report;
+	}
+}
\ No newline at end of file
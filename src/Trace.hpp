@@ -0,0 +1,32 @@
+#pragma once
+
+#include "Archive.hpp"
+#include "Types.hpp"
+
+#include <array>
+#include <filesystem>
+#include <span>
+#include <vector>
+
+// Sector reads logged by an emulator (PCSX2 CDVD log), one read per line as LBA, count and timestamp
+namespace Trace
+{
+	// Seek distances in sectors by power of two, bucket 0 counts sequential reads
+	inline constexpr std::size_t nbSeekBuckets{ 33 };
+
+	struct Report
+	{
+		std::vector<u32> nbReads;
+		std::vector<u64> nbSectorsRead;
+		// Entries in the order of their first read
+		std::vector<u32> firstTouch;
+		std::vector<u64> firstTimestamp;
+		std::array<u64, nbSeekBuckets> seekHistogram;
+		u64 nbTotalReads;
+		// Reads of sectors holding no entry
+		u64 nbOutsideReads;
+	};
+
+	// baseLba is the disc LBA of the first sector of CDDATA.000, lines without at least an LBA and a count are skipped
+	Report analyze(const std::filesystem::path& tracePath, std::span<const Archive::CdDataLocFileInfo> filesInfo, u32 baseLba);
+}
\ No newline at end of file
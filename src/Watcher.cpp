@@ -0,0 +1,178 @@
+#include "Watcher.hpp"
+
+#include "Types.hpp"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+// Written files are closed after writing or moved in by editors saving through a temporary file
+static constexpr u32 watchMask{ IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE };
+
+Watcher::Watcher(const std::filesystem::path& root)
+	: m_root{ root }, m_fd{ ::inotify_init1(IN_CLOEXEC) }
+{
+	if (m_fd == -1)
+	{
+		throw std::runtime_error{ fmt::format("Can't watch \"{}\": {}", root.string(), std::strerror(errno)) };
+	}
+
+	// The destructor doesn't run when the constructor throws
+	try
+	{
+		std::vector<std::filesystem::path> files;
+		add(root, files);
+	}
+	catch (...)
+	{
+		::close(m_fd);
+		throw;
+	}
+}
+
+Watcher::~Watcher()
+{
+	::close(m_fd);
+}
+
+void Watcher::add(const std::filesystem::path& directory, std::vector<std::filesystem::path>& files)
+{
+	const auto watch{ [&](const std::filesystem::path& path)
+	{
+		const auto wd{ ::inotify_add_watch(m_fd, path.c_str(), watchMask) };
+
+		if (wd == -1)
+		{
+			throw std::runtime_error{ fmt::format("Can't watch \"{}\": {}", path.string(), std::strerror(errno)) };
+		}
+		m_directories[wd] = path;
+	}};
+
+	watch(directory);
+
+	for (const auto& entry : std::filesystem::recursive_directory_iterator{ directory })
+	{
+		if (entry.is_directory())
+		{
+			watch(entry.path());
+		}
+		else if (entry.is_regular_file())
+		{
+			files.push_back(entry.path());
+		}
+	}
+}
+
+std::vector<std::filesystem::path> Watcher::wait(std::chrono::milliseconds debounce)
+{
+	alignas(inotify_event) char buffer[64 * 1024];
+	std::vector<std::filesystem::path> files;
+	bool overflow{};
+
+	// No timeout until the first event, then events are gathered until a quiet period
+	for (auto timeout{ -1 }; ; timeout = static_cast<int>(debounce.count()))
+	{
+		pollfd pollFd{ m_fd, POLLIN, 0 };
+		const auto result{ ::poll(&pollFd, 1, timeout) };
+
+		if (result == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		else if (result == -1)
+		{
+			throw std::runtime_error{ fmt::format("Can't watch \"{}\": {}", m_root.string(), std::strerror(errno)) };
+		}
+		else if (result == 0)
+		{
+			break;
+		}
+
+		const auto size{ ::read(m_fd, buffer, sizeof(buffer)) };
+
+		if (size == -1 && errno == EINTR)
+		{
+			continue;
+		}
+		else if (size <= 0)
+		{
+			throw std::runtime_error{ fmt::format("Can't watch \"{}\": {}", m_root.string(), std::strerror(errno)) };
+		}
+
+		for (auto offset{ 0 }; offset < size;)
+		{
+			const auto* const event{ reinterpret_cast<const inotify_event*>(buffer + offset) };
+			offset += sizeof(inotify_event) + event->len;
+
+			if (event->mask & IN_Q_OVERFLOW)
+			{
+				overflow = true;
+				continue;
+			}
+
+			const auto directory{ m_directories.find(event->wd) };
+
+			if (directory == m_directories.end() || event->len == 0)
+			{
+				continue;
+			}
+
+			const auto path{ directory->second / event->name };
+
+			if (event->mask & IN_ISDIR)
+			{
+				// Directories created or moved in are watched, the files already in them are reported
+				if (event->mask & (IN_CREATE | IN_MOVED_TO))
+				{
+					add(path, files);
+				}
+			}
+			else if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+			{
+				files.push_back(path);
+			}
+		}
+	}
+
+	if (overflow)
+	{
+		files.clear();
+		for (const auto& entry : std::filesystem::recursive_directory_iterator{ m_root })
+		{
+			if (entry.is_regular_file())
+			{
+				files.push_back(entry.path());
+			}
+		}
+	}
+
+	std::sort(files.begin(), files.end());
+	files.erase(std::unique(files.begin(), files.end()), files.end());
+	return files;
+}
+#else
+Watcher::Watcher(const std::filesystem::path& root)
+	: m_root{ root }, m_fd{ -1 }
+{
+	throw std::runtime_error{ "Watching files needs inotify, only available on Linux" };
+}
+
+Watcher::~Watcher()
+{
+}
+
+std::vector<std::filesystem::path> Watcher::wait(std::chrono::milliseconds)
+{
+	return {};
+}
+#endif
\ No newline at end of file
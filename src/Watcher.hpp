@@ -0,0 +1,27 @@
+#pragma once
+
+#include <chrono>
+#include <filesystem>
+#include <unordered_map>
+#include <vector>
+
+// Files written in a directory tree, with inotify (Linux only)
+class Watcher
+{
+public:
+	explicit Watcher(const std::filesystem::path& root);
+	Watcher(const Watcher&) = delete;
+	Watcher& operator=(const Watcher&) = delete;
+	~Watcher();
+
+	// Blocks until a file is written then until nothing was for debounce, returns the written files sorted,
+	// every file of the tree when events were lost
+	std::vector<std::filesystem::path> wait(std::chrono::milliseconds debounce);
+private:
+	// Watches directory and its subdirectories, their files are added to files
+	void add(const std::filesystem::path& directory, std::vector<std::filesystem::path>& files);
+
+	std::filesystem::path m_root;
+	int m_fd;
+	std::unordered_map<int, std::filesystem::path> m_directories;
+};
\ No newline at end of file
@@ -0,0 +1,44 @@
+#include "Palette.hpp"
+
+#include "fmt/format.h"
+
+#include <array>
+#include <vector>
+
+// One color weighing more than all the others together is the last one of its box once sorted,
+// the median cut must still split the box in two non-empty halves
+static bool quantizeDominantColor()
+{
+	constexpr u32 dominant{ 0xFF0000FF };
+	std::vector<u32> pixels(4096, dominant);
+
+	for (u32 i{}; i < 40; ++i)
+	{
+		pixels.push_back(0xFF000000 | i * 3 << 8 | i);
+	}
+
+	std::array<u32, 16> palette{};
+	std::vector<u8> indices(pixels.size());
+	Palette::quantize(pixels, {}, {}, palette, indices);
+
+	for (const auto index : indices)
+	{
+		if (index >= palette.size())
+		{
+			return false;
+		}
+	}
+
+	return palette[indices.front()] == dominant;
+}
+
+int main()
+{
+	if (!quantizeDominantColor())
+	{
+		fmt::print("Palette::quantize with a dominant color failed\n");
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file
@@ -0,0 +1,79 @@
+#include "Tim2.hpp"
+
+#include "fmt/format.h"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <vector>
+
+// A 16 color CSM1 CLUT stores the colors of indices 0 to 7 and 16 to 23, encoding must neither
+// write past them nor map pixels to indices whose color isn't stored
+static bool roundTripIndexed8Csm1()
+{
+	constexpr u16 width{ 4 }, height{ 4 }, nbColors{ 16 };
+	constexpr u32 imageSize{ width * height }, clutSize{ nbColors * 4 };
+
+	Tim2::FileHeader fileHeader{ Tim2::magic, 4, 0, 1, {} };
+	Tim2::PictureHeader header{};
+	header.totalSize = sizeof(Tim2::PictureHeader) + imageSize + clutSize;
+	header.clutSize = clutSize;
+	header.imageSize = imageSize;
+	header.headerSize = sizeof(Tim2::PictureHeader);
+	header.nbClutColors = nbColors;
+	header.clutType = Tim2::Rgba32;
+	header.imageType = Tim2::Indexed8;
+	header.width = width;
+	header.height = height;
+
+	std::vector<char> data(sizeof(fileHeader) + header.totalSize);
+	std::memcpy(data.data(), &fileHeader, sizeof(fileHeader));
+	std::memcpy(data.data() + sizeof(fileHeader), &header, sizeof(header));
+
+	// Every stored color used once, opaque
+	auto* const image{ reinterpret_cast<u8*>(data.data()) + sizeof(fileHeader) + sizeof(header) };
+	auto* const clut{ image + imageSize };
+
+	for (u32 i{}; i < nbColors; ++i)
+	{
+		image[i] = static_cast<u8>(Tim2::clutIndex(i, header));
+		const std::array<u8, 4> color{ static_cast<u8>(i * 16), static_cast<u8>(255 - i * 16), static_cast<u8>(i), 0x80 };
+		std::memcpy(clut + i * 4, color.data(), color.size());
+	}
+
+	const auto pictures{ Tim2::pictures(data) };
+	auto pixels{ Tim2::decode(data, pictures.front()) };
+
+	// Two pixels swapped and the color of the first one replaced by a new one
+	std::swap_ranges(pixels.begin(), pixels.begin() + 4, pixels.begin() + 4 * 9);
+	const std::array<u8, 4> newColor{ 0x12, 0x34, 0x56, 0xFF };
+	std::copy(newColor.begin(), newColor.end(), pixels.begin());
+
+	Tim2::encode(data, pictures.front(), pixels);
+
+	if (Tim2::decode(data, pictures.front()) != pixels)
+	{
+		return false;
+	}
+
+	for (u32 i{}; i < imageSize; ++i)
+	{
+		if (Tim2::clutIndex(image[i], header) >= nbColors)
+		{
+			return false;
+		}
+	}
+
+	return true;
+}
+
+int main()
+{
+	if (!roundTripIndexed8Csm1())
+	{
+		fmt::print("Tim2::encode of a 16 color Indexed8 CSM1 texture failed\n");
+		return 1;
+	}
+
+	return 0;
+}
\ No newline at end of file